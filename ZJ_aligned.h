@@ -0,0 +1,80 @@
+
+
+
+#ifndef _ZJ_ALIGNED_
+#define _ZJ_ALIGNED_
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include "ZJ_alloc.h"
+#include "ZJ_vector.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace ZJ {
+
+    // aligned malloc
+    /**
+     * Every block starts on an Align byte boundary (a power of two, 64 by
+     * default: one cache line, enough for AVX-512 aligned loads).
+     * Align below sizeof(void*) is raised to it, as posix_memalign requires.
+     * realloc does not keep the alignment, so reallocate is allocate + memcpy.
+     *
+     * Use it through the allocator wrapper, for vector and deque buffers:
+     *      vector<float, aligned_allocator<float>> v;          // 64 bytes
+     *      deque<int, 0, aligned_allocator<int, 4096>> d;      // page aligned blocks
+     *      aligned_vector<float, 32> w;                        // AVX2
+    */
+    template <size_t Align = 64>
+    class __allocator_aligned {
+        static_assert(Align != 0 && (Align & (Align - 1)) == 0, "alignment must be a power of two");
+
+        public :
+            enum {__ALIGN = Align < sizeof(void*) ? sizeof(void*) : Align};
+
+            static void* allocate(size_t n) {
+                if(n == 0) n = 1;
+                void* res = 0;
+            #if defined(_WIN32)
+                res = _aligned_malloc(n, (size_t)__ALIGN);
+            #else
+                if(posix_memalign(&res, (size_t)__ALIGN, n) != 0) res = 0;
+            #endif
+                if(res == 0) {
+                    cerr << "out of memory (aligned allocation of " << n << " bytes failed)" << endl;
+                    exit(1);
+                }
+                return res;
+            }
+
+            static void deallocate(void* p, size_t) {
+                if(p == 0) return ;
+            #if defined(_WIN32)
+                _aligned_free(p);
+            #else
+                free(p);
+            #endif
+            }
+
+            static void* reallocate(void* p, size_t old_sz, size_t new_sz) {
+                void* res = allocate(new_sz);
+                if(p != 0) {
+                    memcpy(res, p, old_sz < new_sz ? old_sz : new_sz);
+                    deallocate(p, old_sz);
+                }
+                return res;
+            }
+    };
+
+    template <typename T, size_t Align = 64>
+    using aligned_allocator = allocator<T, __allocator_aligned<Align>>;
+
+    template <typename T, size_t Align = 64>
+    using aligned_vector = vector<T, aligned_allocator<T, Align>>;
+
+}
+
+#endif
@@ -6,7 +6,21 @@
 #include <cstddef>
 #include <cstdlib>
 #include <climits>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include "ZJ_utils.h"
+
+// allocation statistics per allocated type, see ZJ_alloc_stats.h
+// without ZJ_ALLOC_STATS the hooks expand to nothing
+#ifdef ZJ_ALLOC_STATS
+    #include "ZJ_alloc_stats.h"
+    #define __ZJ_ALLOC_HOOK(T, p, bytes)   do { ZJ::alloc_stats::on_allocate<T>(bytes); } while(0)
+    #define __ZJ_DEALLOC_HOOK(T, p, bytes) do { if(p) ZJ::alloc_stats::on_deallocate<T>(bytes); } while(0)
+#else
+    #define __ZJ_ALLOC_HOOK(T, p, bytes)
+    #define __ZJ_DEALLOC_HOOK(T, p, bytes)
+#endif
 
 using namespace std;
 
@@ -91,7 +105,10 @@ namespace ZJ_0 { // for experiment purposes
 namespace ZJ {
 
     // malloc
-    class __allocator_malloc {
+    // a template only so its static members can be defined in this header
+    // (one definition for every translation unit), like SGI's inst parameter
+    template <int inst>
+    class __allocator_malloc_template {
 
         private :
             static void (*oom_handler)();
@@ -144,11 +161,237 @@ namespace ZJ {
             }
     };
 
-    // memory pool - to be implemented :(
-    class __allocator_mp {};
+    typedef __allocator_malloc_template<0> __allocator_malloc;
+
+    // memory pool
+    /**
+     * Small blocks (<= __MAX_BYTES) are rounded up to a multiple of __ALIGN
+     * and served from one free list per size class. Large blocks go to malloc.
+     * 
+     * Two levels of free lists: 
+     * thread cache: one per thread, no locking, serves almost every call
+     * central list: shared, guarded by a mutex, only touched in batches of
+     *               __NOBJS blocks when a thread cache runs empty or holds
+     *               more than __MAX_CACHED blocks of a size class
+     * The central list is refilled from big chunks, so malloc is hit once per
+     * chunk instead of once per node. Blocks are never given back to the
+     * system, a thread cache returns its blocks to the central list on exit.
+    */
+    template <int inst>
+    class __allocator_mp_template {
+
+        private :
+            enum {__ALIGN = 8};
+            enum {__MAX_BYTES = 128};
+            enum {__NFREELISTS = __MAX_BYTES / __ALIGN};
+            enum {__NOBJS = 20}; // blocks per transfer between thread cache and central list
+            enum {__MAX_CACHED = 2 * __NOBJS};
+
+            union obj {
+                union obj* free_list_link;
+                char client_data[1];
+            };
+
+            struct thread_cache {
+                obj* free_list[__NFREELISTS];
+                size_t length[__NFREELISTS];
+
+                thread_cache() {
+                    for(int i = 0; i < __NFREELISTS; ++i) {
+                        free_list[i] = 0;
+                        length[i] = 0;
+                    }
+                }
+
+                ~thread_cache() {
+                    for(int i = 0; i < __NFREELISTS; ++i) {
+                        if(free_list[i] != 0) {
+                            obj* last = free_list[i];
+                            while(last->free_list_link != 0) last = last->free_list_link;
+                            release_to_central(i, free_list[i], last);
+                        }
+                        free_list[i] = 0;
+                        length[i] = 0;
+                    }
+                }
+            };
+
+            static thread_local thread_cache cache;
+
+            static mutex central_lock; // guards everything below
+            static obj* central_free_list[__NFREELISTS];
+            static char* start_free; // [start_free, end_free) is the unused part of the current chunk
+            static char* end_free;
+            static size_t heap_size; // total bytes taken from malloc, used to grow the chunks
+
+            static size_t round_up(size_t bytes) {
+                return (bytes + __ALIGN - 1) & ~((size_t)__ALIGN - 1);
+            }
+
+            static size_t freelist_index(size_t bytes) {
+                return (bytes + __ALIGN - 1) / __ALIGN - 1;
+            }
+
+        public :
+            static void* allocate(size_t n) {
+                if(n > (size_t)__MAX_BYTES) return __allocator_malloc::allocate(n);
+                if(n == 0) n = 1;
+                size_t idx = freelist_index(n);
+                thread_cache& tc = cache;
+                obj* res = tc.free_list[idx];
+                if(res == 0) {
+                    int nobjs = __NOBJS;
+                    res = fetch_from_central(round_up(n), nobjs);
+                    tc.length[idx] = nobjs;
+                }
+                tc.free_list[idx] = res->free_list_link;
+                --tc.length[idx];
+                return res;
+            }
+
+            static void deallocate(void* p, size_t n) {
+                if(p == 0) return ;
+                if(n > (size_t)__MAX_BYTES) {
+                    __allocator_malloc::deallocate(p, n);
+                    return ;
+                }
+                if(n == 0) n = 1;
+                size_t idx = freelist_index(n);
+                thread_cache& tc = cache;
+                obj* q = (obj*)p;
+                q->free_list_link = tc.free_list[idx];
+                tc.free_list[idx] = q;
+                if(++tc.length[idx] > (size_t)__MAX_CACHED) {
+                    // hand the first __NOBJS blocks back in one go
+                    obj* last = q;
+                    for(int i = 1; i < __NOBJS; ++i) last = last->free_list_link;
+                    tc.free_list[idx] = last->free_list_link;
+                    tc.length[idx] -= __NOBJS;
+                    release_to_central(idx, q, last);
+                }
+            }
+
+            static void* reallocate(void* p, size_t old_sz, size_t new_sz) {
+                if(old_sz > (size_t)__MAX_BYTES && new_sz > (size_t)__MAX_BYTES)
+                    return __allocator_malloc::reallocate(p, old_sz, new_sz);
+                if(p != 0 && round_up(old_sz) == round_up(new_sz)) return p;
+                void* res = allocate(new_sz);
+                if(p != 0) {
+                    memcpy(res, p, old_sz < new_sz ? old_sz : new_sz);
+                    deallocate(p, old_sz);
+                }
+                return res;
+            }
+
+        protected :
+            // n is already rounded up, returns a chain of nobjs blocks,
+            // nobjs is set to the number actually handed out
+            static obj* fetch_from_central(size_t n, int& nobjs) {
+                lock_guard<mutex> guard(central_lock);
+                obj** my_free_list = central_free_list + freelist_index(n);
+                obj* res = *my_free_list;
+                if(res != 0) {
+                    obj* last = res;
+                    int got = 1;
+                    for(; got < nobjs && last->free_list_link != 0; ++got) last = last->free_list_link;
+                    *my_free_list = last->free_list_link;
+                    last->free_list_link = 0;
+                    nobjs = got;
+                    return res;
+                }
+                char* chunk = chunk_alloc(n, nobjs);
+                res = (obj*)chunk;
+                obj* cur = res;
+                for(int i = 1; i < nobjs; ++i) {
+                    obj* next = (obj*)((char*)cur + n);
+                    cur->free_list_link = next;
+                    cur = next;
+                }
+                cur->free_list_link = 0;
+                return res;
+            }
+
+            // puts the chain [first, last] back on the central free list
+            static void release_to_central(size_t idx, obj* first, obj* last) {
+                lock_guard<mutex> guard(central_lock);
+                last->free_list_link = central_free_list[idx];
+                central_free_list[idx] = first;
+            }
+
+            // takes up to nobjs blocks of size bytes from the current chunk,
+            // nobjs is set to the number actually handed out, central_lock must be held
+            static char* chunk_alloc(size_t size, int& nobjs) {
+                size_t total_bytes = size * nobjs;
+                size_t bytes_left = end_free - start_free;
+                char* res;
+                if(bytes_left >= total_bytes) {
+                    res = start_free;
+                    start_free += total_bytes;
+                    return res;
+                }
+                else if(bytes_left >= size) {
+                    nobjs = (int)(bytes_left / size);
+                    total_bytes = size * nobjs;
+                    res = start_free;
+                    start_free += total_bytes;
+                    return res;
+                }
+                // not even one block left: put the leftover on its free list and get a new chunk
+                if(bytes_left > 0) {
+                    obj** my_free_list = central_free_list + freelist_index(bytes_left);
+                    ((obj*)start_free)->free_list_link = *my_free_list;
+                    *my_free_list = (obj*)start_free;
+                }
+                size_t bytes_to_get = 2 * total_bytes + round_up(heap_size >> 4);
+                start_free = (char*)malloc(bytes_to_get);
+                if(start_free == 0) {
+                    // out of memory, try to borrow a free block of a bigger size class
+                    for(size_t i = size; i <= (size_t)__MAX_BYTES; i += __ALIGN) {
+                        obj** my_free_list = central_free_list + freelist_index(i);
+                        obj* p = *my_free_list;
+                        if(p != 0) {
+                            *my_free_list = p->free_list_link;
+                            start_free = (char*)p;
+                            end_free = start_free + i;
+                            return chunk_alloc(size, nobjs);
+                        }
+                    }
+                    end_free = 0;
+                    start_free = (char*)__allocator_malloc::allocate(bytes_to_get); // oom handler
+                }
+                heap_size += bytes_to_get;
+                end_free = start_free + bytes_to_get;
+                return chunk_alloc(size, nobjs);
+            }
+    };
+
+    template <int inst>
+    void (*__allocator_malloc_template<inst>::oom_handler)() = nullptr;
+
+    template <int inst>
+    thread_local typename __allocator_mp_template<inst>::thread_cache __allocator_mp_template<inst>::cache;
+
+    template <int inst>
+    mutex __allocator_mp_template<inst>::central_lock;
+
+    template <int inst>
+    typename __allocator_mp_template<inst>::obj* __allocator_mp_template<inst>::central_free_list[__NFREELISTS] = {0};
+
+    template <int inst>
+    char* __allocator_mp_template<inst>::start_free = 0;
 
-    #define __ALLOCATOR__MALLOC__  // here which allocator is specify
-    //#define __ALLOCATOR__MP__
+    template <int inst>
+    char* __allocator_mp_template<inst>::end_free = 0;
+
+    template <int inst>
+    size_t __allocator_mp_template<inst>::heap_size = 0;
+
+    typedef __allocator_mp_template<0> __allocator_mp;
+
+    //#define __ALLOCATOR__MP__  // here which allocator is specify, malloc by default
+    #ifndef __ALLOCATOR__MP__
+        #define __ALLOCATOR__MALLOC__
+    #endif
 
     #ifdef __ALLOCATOR__MALLOC__
         typedef __allocator_malloc Alloc;
@@ -158,7 +401,8 @@ namespace ZJ {
 
 
     // allocator wrapper
-    template<typename T>
+    // Policy is one of the raw allocators above (static allocate / deallocate / reallocate on bytes)
+    template<typename T, typename Policy = Alloc>
     class allocator {
         public :
             typedef T           value_type;
@@ -168,23 +412,155 @@ namespace ZJ {
             typedef const T&    const_reference;
             typedef size_t      size_type;
             typedef ptrdiff_t   difference_type;
+            typedef Policy      policy_type;
 
             template<typename U>
             struct rebind {
-                typedef allocator<U> other;
+                typedef allocator<U, Policy> other;
             };
 
         public :
+            allocator() {}
+
+            template<typename U>
+            allocator(const allocator<U, Policy>&) {}
+
             static T* allocate(size_t n, void* hint = 0) {
-                return (T*)Alloc::allocate(n * sizeof(T));
+                T* res = (T*)Policy::allocate(n * sizeof(T));
+                __ZJ_ALLOC_HOOK(T, res, n * sizeof(T));
+                return res;
             }
 
             static void deallocate(T* p, size_t n) {
-                Alloc::deallocate(p, n);
+                __ZJ_DEALLOC_HOOK(T, p, n * sizeof(T));
+                Policy::deallocate(p, n * sizeof(T));
             }
+
+            // resizes the block, moving it bytewise if needed (the policy uses realloc / mremap),
+            // only for element types that may be moved with memcpy
+            static T* reallocate(T* p, size_t old_n, size_t new_n) {
+                __ZJ_DEALLOC_HOOK(T, p, old_n * sizeof(T));
+                T* res = (T*)Policy::reallocate(p, old_n * sizeof(T), new_n * sizeof(T));
+                __ZJ_ALLOC_HOOK(T, res, new_n * sizeof(T));
+                return res;
+            }
+
+            // stateless, memory from any instance can be freed by any other
+            bool operator== (const allocator&) const {return true;}
+
+            bool operator!= (const allocator&) const {return false;}
+    };
+
+    /**
+     * Containers store their allocator as a (private or protected) base class,
+     * so an allocator without state adds nothing to the container size (EBO)
+     * and a stateful one (arena, per-request pool) travels with the container.
+     * Node based containers rebind the allocator they are given to their node type.
+    */
+    template <typename Alloc, typename U>
+    struct alloc_rebind {
+        typedef typename Alloc::template rebind<U>::other other;
+    };
+
+    /**
+     * IS_MONOTONIC: deallocate() is a no-op and the memory is released in bulk
+     * by its owner (see ZJ_arena.h). A container may then drop its nodes
+     * without visiting them, as long as the values need no destructor.
+     * HAS_REALLOCATE: reallocate(p, old_n, new_n) is there, vector grows
+     * through it when its elements may be moved with memcpy.
+     * HAS_ALLOCATE_N: ZJ_allocate_n(a, out, n) gets n single objects for about
+     * the price of one (slab_allocator, ZJ_slab.h), range inserts batch through it.
+    */
+    template <typename Alloc>
+    class alloc_traits {
+        public : 
+            typedef FALSE_TAG IS_MONOTONIC;
+            typedef FALSE_TAG HAS_REALLOCATE;
+            typedef FALSE_TAG HAS_ALLOCATE_N;
     };
 
-    void (*ZJ::__allocator_malloc::oom_handler)() = nullptr;
+    template <typename T, typename Policy>
+    class alloc_traits<allocator<T, Policy>> {
+        public : 
+            typedef FALSE_TAG IS_MONOTONIC;
+            typedef TRUE_TAG HAS_REALLOCATE;
+            typedef FALSE_TAG HAS_ALLOCATE_N;
+    };
+
+    // fills out[0, n) with single objects, allocators that can do better
+    // (slab_allocator, ZJ_slab.h) provide their own overload
+    template <typename Alloc, typename T>
+    inline void ZJ_allocate_n(Alloc& a, T** out, size_t n) {
+        for(size_t i = 0; i < n; ++i)
+            out[i] = a.allocate(1);
+    }
+
+    /**
+     * Node source for range inserts.
+     * With a bulk allocator (HAS_ALLOCATE_N) it takes nodes in batches
+     * through ZJ_allocate_n, starting small and doubling up to __BATCH so a
+     * short range does not over-allocate, and hands the unused ones back when
+     * it goes out of scope. With any other allocator it takes one node per
+     * get(): batching would only add deallocations, and on an arena the
+     * unused nodes would be lost until release().
+    */
+    template <typename Alloc, typename Bulk = typename alloc_traits<Alloc>::HAS_ALLOCATE_N>
+    class node_batch;
+
+    template <typename Alloc>
+    class node_batch<Alloc, FALSE_TAG> {
+        public :
+            typedef typename Alloc::value_type node_type;
+
+        private :
+            Alloc& a;
+
+        public :
+            explicit node_batch(Alloc& alloc) : a(alloc) {}
+
+            node_type* get() {return a.allocate(1);}
+
+        private :
+            node_batch(const node_batch&);
+            node_batch& operator= (const node_batch&);
+    };
+
+    template <typename Alloc>
+    class node_batch<Alloc, TRUE_TAG> {
+        public :
+            typedef typename Alloc::value_type node_type;
+
+        private :
+            enum {__BATCH = 32};
+
+            Alloc& a;
+            node_type* nodes[__BATCH];
+            size_t cur;
+            size_t cnt;
+            size_t next_size;
+
+        public :
+            explicit node_batch(Alloc& alloc) : a(alloc), cur(0), cnt(0), next_size(4) {}
+
+            ~node_batch() {
+                for(; cur < cnt; ++cur)
+                    a.deallocate(nodes[cur], 1);
+            }
+
+            node_type* get() {
+                if(cur == cnt) {
+                    ZJ_allocate_n(a, nodes, next_size);
+                    cur = 0;
+                    cnt = next_size;
+                    if(next_size < (size_t)__BATCH) next_size *= 2;
+                }
+                return nodes[cur++];
+            }
+
+        private :
+            node_batch(const node_batch&);
+            node_batch& operator= (const node_batch&);
+    };
 
 /*
     template <typename T>
@@ -0,0 +1,174 @@
+
+
+
+#ifndef _ZJ_ALLOC_STATS_
+#define _ZJ_ALLOC_STATS_
+
+#include <cstddef>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <typeinfo>
+#include <iostream>
+#include <iomanip>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace ZJ {
+
+    /**
+     * Allocation statistics, only compiled in with ZJ_ALLOC_STATS defined
+     * (ZJ_alloc.h includes this file and turns its hooks on).
+     * One record per allocated type, not per container: allocator and
+     * slab_allocator report every allocate / deallocate under the type they
+     * hand out. Node based containers rebind to their node type, so those
+     * records are told apart by node type; containers that allocate the
+     * element type itself all land in the same record, e.g.
+     *      ZJ::rb_node<ZJ::pair<int const, std::string> >    map<int, string>
+     *      ZJ::hashtable_node<int>                            unordered_set<int>, unordered_multiset<int>
+     *      ZJ::hashtable_node<int>*                           their bucket arrays
+     *      int                                                vector<int>, deque<int>, circular_buffer<int>, ...
+     * Counters are relaxed atomics, records live until the end of the program.
+     *
+     *      ZJ::alloc_stats::report(cerr);                      // sorted by peak bytes
+     *      std::vector<ZJ::alloc_stat> s = ZJ::alloc_stats::snapshot();
+    */
+
+    enum {__ALLOC_STATS_BUCKETS = 32}; // histogram bucket i counts requests of [2^i, 2^(i+1)) bytes
+
+    struct alloc_record {
+        std::string name;
+        std::atomic<size_t> allocs;
+        std::atomic<size_t> deallocs;
+        std::atomic<size_t> live_bytes;
+        std::atomic<size_t> peak_bytes;
+        std::atomic<size_t> histogram[__ALLOC_STATS_BUCKETS];
+        alloc_record* next;
+
+        explicit alloc_record(const std::string& n) : name(n), allocs(0), deallocs(0), live_bytes(0), peak_bytes(0), next(0) {
+            for(int i = 0; i < __ALLOC_STATS_BUCKETS; ++i) histogram[i] = 0;
+        }
+    };
+
+    // plain copy of one record
+    struct alloc_stat {
+        std::string name;
+        size_t allocs;
+        size_t deallocs;
+        size_t live_bytes;
+        size_t peak_bytes;
+        size_t histogram[__ALLOC_STATS_BUCKETS];
+    };
+
+    class alloc_stats {
+        public :
+            template <typename T>
+            static void on_allocate(size_t bytes) {
+                alloc_record& r = record_for<T>();
+                r.allocs.fetch_add(1, std::memory_order_relaxed);
+                r.histogram[bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+                size_t live = r.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+                size_t peak = r.peak_bytes.load(std::memory_order_relaxed);
+                while(live > peak && !r.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) ;
+            }
+
+            template <typename T>
+            static void on_deallocate(size_t bytes) {
+                alloc_record& r = record_for<T>();
+                r.deallocs.fetch_add(1, std::memory_order_relaxed);
+                r.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            }
+
+            // one entry per type that allocated so far
+            static std::vector<alloc_stat> snapshot() {
+                std::vector<alloc_stat> res;
+                std::lock_guard<std::mutex> guard(registry_lock());
+                for(alloc_record* r = registry(); r; r = r->next) {
+                    alloc_stat s;
+                    s.name = r->name;
+                    s.allocs = r->allocs.load(std::memory_order_relaxed);
+                    s.deallocs = r->deallocs.load(std::memory_order_relaxed);
+                    s.live_bytes = r->live_bytes.load(std::memory_order_relaxed);
+                    s.peak_bytes = r->peak_bytes.load(std::memory_order_relaxed);
+                    for(int i = 0; i < __ALLOC_STATS_BUCKETS; ++i)
+                        s.histogram[i] = r->histogram[i].load(std::memory_order_relaxed);
+                    res.push_back(s);
+                }
+                return res;
+            }
+
+            // table sorted by peak bytes, biggest first, followed by the size histograms
+            static void report(std::ostream& os) {
+                std::vector<alloc_stat> s = snapshot();
+                std::sort(s.begin(), s.end(), by_peak);
+                os << std::left << std::setw(12) << "allocs" << std::setw(12) << "deallocs"
+                   << std::setw(14) << "live bytes" << std::setw(14) << "peak bytes" << "type" << "\n";
+                for(size_t i = 0; i < s.size(); ++i) {
+                    os << std::setw(12) << s[i].allocs << std::setw(12) << s[i].deallocs
+                       << std::setw(14) << s[i].live_bytes << std::setw(14) << s[i].peak_bytes << s[i].name << "\n";
+                    os << "    sizes:";
+                    for(int b = 0; b < __ALLOC_STATS_BUCKETS; ++b)
+                        if(s[i].histogram[b]) os << " [" << ((size_t)1 << b) << ", " << ((size_t)2 << b) << "): " << s[i].histogram[b];
+                    os << "\n";
+                }
+                os << std::right;
+            }
+
+        private :
+            template <typename T>
+            static alloc_record& record_for() {
+                static alloc_record* r = make_record(type_name<T>());
+                return *r;
+            }
+
+            static alloc_record* make_record(const std::string& name) {
+                alloc_record* r = new alloc_record(name);
+                std::lock_guard<std::mutex> guard(registry_lock());
+                r->next = registry();
+                registry() = r;
+                return r;
+            }
+
+            static alloc_record*& registry() {
+                static alloc_record* head = 0;
+                return head;
+            }
+
+            static std::mutex& registry_lock() {
+                static std::mutex m;
+                return m;
+            }
+
+            template <typename T>
+            static std::string type_name() {
+                const char* raw = typeid(T).name();
+            #if defined(__GNUG__)
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(raw, 0, 0, &status);
+                if(status == 0 && demangled) {
+                    std::string res(demangled);
+                    free(demangled);
+                    return res;
+                }
+            #endif
+                return raw;
+            }
+
+            static int bucket(size_t bytes) {
+                int i = 0;
+                while(bytes >>= 1) ++i;
+                return i < __ALLOC_STATS_BUCKETS ? i : __ALLOC_STATS_BUCKETS - 1;
+            }
+
+            static bool by_peak(const alloc_stat& a, const alloc_stat& b) {
+                return a.peak_bytes > b.peak_bytes;
+            }
+    };
+
+}
+
+#endif
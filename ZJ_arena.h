@@ -0,0 +1,155 @@
+
+
+
+#ifndef _ZJ_ARENA_
+#define _ZJ_ARENA_
+
+#include <cstddef>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+
+namespace ZJ {
+
+    /**
+     * Monotonic (bump pointer) arena.
+     * Memory is carved from chunks that double in size, nothing is freed one
+     * by one: release() gives back every chunk at once, O(chunks).
+     * Typical use is request-scoped containers:
+     *
+     *      arena a;
+     *      map<int, int, less<int>, arena_allocator<pair<const int, int>>> m(less<int>(), &a);
+     *      ...
+     *      // m goes out of scope, then a (or a.release())
+     *
+     * Containers on an arena_allocator skip the per-node walk in clear() and
+     * in their destructor when the values are trivially destructible.
+     * Not thread-safe, one arena per thread / request.
+    */
+    class arena {
+        private :
+            struct chunk {
+                chunk* next;
+                size_t size; // usable bytes after the header
+            };
+
+            enum {__ALIGN = 16};
+
+            chunk* chunks; // most recent first
+            char* cur;
+            char* end;
+            size_t next_chunk_size;
+            size_t used;
+
+        public :
+            explicit arena(size_t initial_size = 4096) :
+                chunks(0), cur(0), end(0), next_chunk_size(initial_size), used(0) {}
+
+            ~arena() {release();}
+
+            void* allocate(size_t n, size_t align = __ALIGN) {
+                char* p = align_up(cur, align);
+                if(cur == 0 || p + n > end) {
+                    new_chunk(n + align);
+                    p = align_up(cur, align);
+                }
+                cur = p + n;
+                used += n;
+                return p;
+            }
+
+            void deallocate(void*, size_t) {} // no-op, see release()
+
+            // frees all the memory handed out so far in one go
+            void release() {
+                while(chunks) {
+                    chunk* next = chunks->next;
+                    __allocator_malloc::deallocate(chunks, sizeof(chunk) + chunks->size);
+                    chunks = next;
+                }
+                cur = end = 0;
+                used = 0;
+            }
+
+            size_t bytes_used() const {return used;}
+
+            size_t bytes_reserved() const {
+                size_t res = 0;
+                for(chunk* c = chunks; c; c = c->next) res += c->size;
+                return res;
+            }
+
+        private :
+            arena(const arena&);
+            arena& operator= (const arena&);
+
+            static char* align_up(char* p, size_t align) {
+                return (char*)(((size_t)p + align - 1) & ~(align - 1));
+            }
+
+            void new_chunk(size_t min_size) {
+                size_t sz = next_chunk_size;
+                while(sz < min_size) sz *= 2;
+                next_chunk_size = sz * 2;
+                chunk* c = (chunk*)__allocator_malloc::allocate(sizeof(chunk) + sz);
+                c->next = chunks;
+                c->size = sz;
+                chunks = c;
+                cur = (char*)(c + 1);
+                end = cur + sz;
+            }
+    };
+
+    // allocator wrapper that draws from an arena, deallocate is a no-op
+    template <typename T>
+    class arena_allocator {
+        public :
+            typedef T           value_type;
+            typedef T*          pointer;
+            typedef const T*    const_pointer;
+            typedef T&          reference;
+            typedef const T&    const_reference;
+            typedef size_t      size_type;
+            typedef ptrdiff_t   difference_type;
+
+            template<typename U>
+            struct rebind {
+                typedef arena_allocator<U> other;
+            };
+
+            template <typename U>
+            friend class arena_allocator;
+
+        private :
+            arena* a;
+
+        public :
+            // no default constructor: a container on an arena_allocator has to be given its arena
+            arena_allocator(arena* ar) : a(ar) {}
+
+            template <typename U>
+            arena_allocator(const arena_allocator<U>& rhs) : a(rhs.a) {}
+
+            T* allocate(size_t n, void* = 0) {
+                return (T*)a->allocate(n * sizeof(T), alignof(T));
+            }
+
+            void deallocate(T*, size_t) {}
+
+            arena* get_arena() const {return a;}
+
+            bool operator== (const arena_allocator& rhs) const {return a == rhs.a;}
+
+            bool operator!= (const arena_allocator& rhs) const {return a != rhs.a;}
+    };
+
+    template <typename T>
+    class alloc_traits<arena_allocator<T>> {
+        public :
+            typedef TRUE_TAG IS_MONOTONIC;
+            typedef FALSE_TAG HAS_REALLOCATE;
+            typedef FALSE_TAG HAS_ALLOCATE_N;
+    };
+
+}
+
+#endif
@@ -0,0 +1,363 @@
+
+
+
+#ifndef _ZJ_CIRCULAR_BUFFER_
+#define _ZJ_CIRCULAR_BUFFER_
+
+#include <cstddef>
+#include <cstring>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+
+namespace ZJ {
+
+    // logical index i is the slot buf[i & mask], index 0 is the oldest element
+    template <typename T, typename Ptr, typename Ref>
+    class circular_buffer_iterator : public iterator_base<random_access_iterator_tag, T> {
+        public :
+            typedef circular_buffer_iterator<T, T*, T&>         iterator;
+            typedef circular_buffer_iterator<T, Ptr, Ref>       self;
+            typedef Ptr                                         pointer;
+            typedef Ref                                         reference;
+            typedef size_t                                      size_type;
+            typedef ptrdiff_t                                   difference_type;
+
+            T* buf;
+            size_type mask;
+            size_type index;
+
+            circular_buffer_iterator() : buf(0), mask(0), index(0) {}
+
+            circular_buffer_iterator(T* b, size_type m, size_type i) : buf(b), mask(m), index(i) {}
+
+            circular_buffer_iterator(const iterator& it) : buf(it.buf), mask(it.mask), index(it.index) {}
+
+            reference operator* () const {return buf[index & mask];}
+
+            pointer operator-> () const {return buf + (index & mask);}
+
+            reference operator[] (difference_type n) const {return buf[(index + n) & mask];}
+
+            self& operator++ () {++index; return *this;}
+
+            self& operator-- () {--index; return *this;}
+
+            self operator++ (int) {
+                self res(*this);
+                ++index;
+                return res;
+            }
+
+            self operator-- (int) {
+                self res(*this);
+                --index;
+                return res;
+            }
+
+            self& operator+= (difference_type n) {index += n; return *this;}
+
+            self& operator-= (difference_type n) {index -= n; return *this;}
+
+            self operator+ (difference_type n) const {return self(buf, mask, index + n);}
+
+            self operator- (difference_type n) const {return self(buf, mask, index - n);}
+
+            // indices run freely and wrap around size_t, differences stay right
+            difference_type operator- (const self& rhs) const {return (difference_type)(index - rhs.index);}
+
+            bool operator== (const self& rhs) const {return index == rhs.index;}
+
+            bool operator!= (const self& rhs) const {return index != rhs.index;}
+
+            bool operator< (const self& rhs) const {return (difference_type)(index - rhs.index) < 0;}
+    };
+
+    /**
+     * FIFO ring over one array whose capacity is a power of two: head and
+     * tail count pushes and pops without ever being wrapped, the slot of an
+     * index is index & mask, so push / pop are a store, an and and an add,
+     * with no buffer boundary to check like deque_iterator has.
+     *
+     * When a push finds the buffer full it either grows (GROW, the default,
+     * doubles the capacity) or drops the oldest element (OVERWRITE, for
+     * bounded logs where the newest data matters most).
+     * push_n / pop_n move a batch with at most two copies, one for the run
+     * up to the end of the array and one for the wrapped part; trivially
+     * copyable types get two memcpy.
+     *
+     *      circular_buffer<sample> last_samples(4096, circular_buffer<sample>::OVERWRITE);
+     *      last_samples.push_n(batch, n);
+     *      queue<event, circular_buffer<event>> events;
+    */
+    template <typename T, typename Alloc = ZJ::allocator<T>>
+    class circular_buffer : protected Alloc {
+        public :
+            typedef T                                               value_type;
+            typedef Alloc                                           allocator_type;
+            typedef T*                                              pointer;
+            typedef const T*                                        const_pointer;
+            typedef circular_buffer_iterator<T, T*, T&>             iterator;
+            typedef circular_buffer_iterator<T, const T*, const T&> const_iterator;
+            typedef T&                                              reference;
+            typedef const T&                                        const_reference;
+            typedef size_t                                          size_type;
+            typedef ptrdiff_t                                       difference_type;
+
+            enum overflow_policy {
+                GROW,       // a full buffer doubles its capacity
+                OVERWRITE   // a full buffer drops its oldest element, the capacity never changes
+            };
+
+        protected :
+            typedef Alloc data_allocator;
+
+            enum {MIN_CAPACITY = 8}; // first growth of an empty GROW buffer
+
+            pointer buf;
+            size_type mask;     // capacity - 1, 0 while buf is 0
+            size_type head;     // index of the oldest element
+            size_type tail;     // index of the next push, size() is tail - head
+            overflow_policy policy;
+
+        public :
+            circular_buffer() : buf(0), mask(0), head(0), tail(0), policy(GROW) {}
+
+            // capacity is rounded up to a power of two
+            explicit circular_buffer(size_type capacity, overflow_policy p = GROW, const Alloc& a = Alloc()) :
+                Alloc(a), buf(0), mask(0), head(0), tail(0), policy(p) {
+                reserve(capacity);
+            }
+
+            circular_buffer(const circular_buffer& c) :
+                Alloc(c.get_allocator()), buf(0), mask(0), head(0), tail(0), policy(c.policy) {
+                if(c.buf == 0) return ;
+                buf = data_allocator::allocate(c.capacity());
+                mask = c.mask;
+                size_type n = c.size(), run = c.first_run(c.head, n);
+                ZJ_uninitialized_copy(c.buf + (c.head & c.mask), c.buf + (c.head & c.mask) + run, buf);
+                ZJ_uninitialized_copy(c.buf, c.buf + (n - run), buf + run);
+                tail = n;
+            }
+
+            circular_buffer(circular_buffer&& c) :
+                Alloc(c.get_allocator()), buf(c.buf), mask(c.mask), head(c.head), tail(c.tail), policy(c.policy) {
+                c.buf = 0;
+                c.mask = c.head = c.tail = 0;
+            }
+
+            ~circular_buffer() {
+                clear();
+                if(buf) data_allocator::deallocate(buf, capacity());
+            }
+
+            circular_buffer& operator= (const circular_buffer& rhs) {
+                if(this != &rhs) {
+                    circular_buffer tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            circular_buffer& operator= (circular_buffer&& rhs) {
+                if(this != &rhs) {
+                    circular_buffer tmp(std::move(rhs));
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return *static_cast<const Alloc*>(this);}
+
+            iterator begin() {return iterator(buf, mask, head);}
+
+            const_iterator begin() const {return const_iterator(iterator(buf, mask, head));}
+
+            const_iterator cbegin() const {return begin();}
+
+            iterator end() {return iterator(buf, mask, tail);}
+
+            const_iterator end() const {return const_iterator(iterator(buf, mask, tail));}
+
+            const_iterator cend() const {return end();}
+
+            reference front() {return buf[head & mask];}
+
+            const_reference front() const {return buf[head & mask];}
+
+            reference back() {return buf[(tail - 1) & mask];}
+
+            const_reference back() const {return buf[(tail - 1) & mask];}
+
+            // idx 0 is the oldest element
+            reference operator[] (size_type idx) {return buf[(head + idx) & mask];}
+
+            const_reference operator[] (size_type idx) const {return buf[(head + idx) & mask];}
+
+            size_type size() const {return tail - head;}
+
+            size_type capacity() const {return buf ? mask + 1 : 0;}
+
+            bool empty() const {return head == tail;}
+
+            bool full() const {return size() == capacity();}
+
+            overflow_policy get_policy() const {return policy;}
+
+            void set_policy(overflow_policy p) {policy = p;}
+
+            // capacity to the power of two >= n, the elements move to the new array
+            void reserve(size_type n) {
+                if(n <= capacity()) return ;
+                size_type new_cap = 1;
+                while(new_cap < n) new_cap *= 2;
+                reallocate(new_cap);
+            }
+
+            void push_back(const value_type& value) {
+                emplace_back(value);
+            }
+
+            void push_back(value_type&& value) {
+                emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_back(Args&&... args) {
+                if(size() == capacity()) {
+                    // args may refer to an element that is about to move or be dropped
+                    value_type tmp(std::forward<Args>(args)...);
+                    if(!make_room()) return ;
+                    ZJ_construct(buf + (tail & mask), std::move(tmp));
+                }
+                else ZJ_construct(buf + (tail & mask), std::forward<Args>(args)...);
+                ++tail;
+            }
+
+            void pop_front() {
+                ZJ_destroy(buf + (head & mask));
+                ++head;
+            }
+
+            void pop_back() {
+                --tail;
+                ZJ_destroy(buf + (tail & mask));
+            }
+
+            // copies src[0, n) in at the back, src must not point into this buffer;
+            // OVERWRITE drops the oldest elements to fit, and keeps only the last
+            // capacity() elements of src when n is larger
+            void push_n(const value_type* src, size_type n) {
+                if(policy == OVERWRITE) {
+                    if(n > capacity()) {
+                        src += n - capacity();
+                        n = capacity();
+                    }
+                    if(size() + n > capacity()) destroy_front(size() + n - capacity());
+                }
+                else reserve(size() + n);
+                if(n == 0) return ;
+                size_type run = first_run(tail, n);
+                ZJ_uninitialized_copy(src, src + run, buf + (tail & mask));
+                ZJ_uninitialized_copy(src + run, src + n, buf);
+                tail += n;
+            }
+
+            // moves the min(n, size()) oldest elements to dest[0, ...) and pops
+            // them, returns how many; dest holds constructed elements, they are assigned
+            size_type pop_n(value_type* dest, size_type n) {
+                if(n > size()) n = size();
+                if(n == 0) return 0;
+                size_type run = first_run(head, n);
+                pointer first = buf + (head & mask);
+                move_out(first, first + run, dest, typename traits<value_type>::IS_TRIVIALLY_COPYABLE());
+                move_out(buf, buf + (n - run), dest + run, typename traits<value_type>::IS_TRIVIALLY_COPYABLE());
+                destroy_front(n);
+                return n;
+            }
+
+            // keeps the array
+            void clear() {destroy_front(size());}
+
+            // the array to the smallest power of two that holds size()
+            void shrink_to_fit() {
+                if(empty()) {
+                    if(buf) data_allocator::deallocate(buf, capacity());
+                    buf = 0;
+                    mask = head = tail = 0;
+                    return ;
+                }
+                size_type new_cap = 1;
+                while(new_cap < size()) new_cap *= 2;
+                if(new_cap < capacity()) reallocate(new_cap);
+            }
+
+            void swap(circular_buffer& rhs) {
+                ZJ_swap(static_cast<Alloc&>(*this), static_cast<Alloc&>(rhs));
+                ZJ_swap(buf, rhs.buf);
+                ZJ_swap(mask, rhs.mask);
+                ZJ_swap(head, rhs.head);
+                ZJ_swap(tail, rhs.tail);
+                ZJ_swap(policy, rhs.policy);
+            }
+
+        protected :
+            // of n elements from index i on, how many come before the end of the array
+            size_type first_run(size_type i, size_type n) const {
+                size_type to_end = capacity() - (i & mask);
+                return n < to_end ? n : to_end;
+            }
+
+            // a full buffer gets a free slot at tail; false if it cannot (OVERWRITE with no array)
+            bool make_room() {
+                if(policy == OVERWRITE) {
+                    if(buf == 0) return false;
+                    pop_front();
+                }
+                else reallocate(buf ? 2 * capacity() : (size_type)MIN_CAPACITY);
+                return true;
+            }
+
+            // destroys the n oldest elements
+            void destroy_front(size_type n) {
+                if(n == 0) return ;
+                size_type run = first_run(head, n);
+                pointer first = buf + (head & mask);
+                ZJ_destroy(first, first + run);
+                ZJ_destroy(buf, buf + (n - run));
+                head += n;
+            }
+
+            // new_cap >= size() is a power of two; the elements are relocated to
+            // the front of the new array in two runs
+            void reallocate(size_type new_cap) {
+                pointer new_buf = data_allocator::allocate(new_cap);
+                size_type n = size();
+                if(n) {
+                    size_type run = first_run(head, n);
+                    ZJ_relocate(buf + (head & mask), buf + (head & mask) + run, new_buf);
+                    ZJ_relocate(buf, buf + (n - run), new_buf + run);
+                }
+                if(buf) data_allocator::deallocate(buf, capacity());
+                buf = new_buf;
+                mask = new_cap - 1;
+                head = 0;
+                tail = n;
+            }
+
+            static void move_out(pointer first, pointer last, pointer dest, TRUE_TAG) {
+                if(first != last) memcpy((void*)dest, (const void*)first, (last - first) * sizeof(value_type));
+            }
+
+            static void move_out(pointer first, pointer last, pointer dest, FALSE_TAG) {
+                for(; first != last; ++first, ++dest) *dest = std::move(*first);
+            }
+    };
+
+    // one pointer to the heap
+    template <typename T, typename Alloc>
+    struct is_trivially_relocatable<circular_buffer<T, Alloc>> : is_trivially_relocatable<Alloc> {};
+
+}
+
+#endif
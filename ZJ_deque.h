@@ -8,10 +8,35 @@
 #include "ZJ_alloc.h"
 #include "ZJ_utils.h"
 #include "ZJ_iterator.h"
+#include "ZJ_vector.h"
+
+// bytes per deque buffer when no element count is given, see deque_buffer_bytes
+#ifndef ZJ_DEQUE_BUFFER_BYTES
+#define ZJ_DEQUE_BUFFER_BYTES 4096
+#endif
 
 
 namespace ZJ {
 
+    /**
+     * Elements per deque buffer for a byte budget, at least one:
+     *      deque<int, deque_buffer_bytes<int, 65536>::value> d;   // 64 KB buffers
+     * deque<T> (B_SIZE 0) uses ZJ_DEQUE_BUFFER_BYTES, 4 KB: one page, one
+     * allocation per 1024 ints. Larger buffers make push_back cheaper still
+     * but cost that much memory for every deque, even an empty one;
+     * bench/deque_buffer_sweep.cpp measures the trade-off.
+    */
+    template <typename T, size_t BYTES>
+    struct deque_buffer_bytes {
+        enum {value = sizeof(T) < BYTES ? BYTES / sizeof(T) : 1};
+    };
+
+    // B_SIZE elements, or the default byte budget when B_SIZE is 0
+    template <typename T, size_t B_SIZE>
+    struct __deque_buffer_size {
+        enum {value = B_SIZE != 0 ? B_SIZE : (size_t)deque_buffer_bytes<T, ZJ_DEQUE_BUFFER_BYTES>::value};
+    };
+
     template <typename T, typename pointer, typename reference, size_t B_SIZE>
     class deque_iterator : public iterator_base<random_access_iterator_tag, T> {
         public : 
@@ -25,13 +50,14 @@ namespace ZJ {
             typedef size_t                                          size_type;
             typedef ptrdiff_t                                       difference_type;
 
-            static size_t buffer_size() {return B_SIZE != 0 ? B_SIZE : (sizeof(T) < 512 ? 512 / sizeof(T) : 1);}
+            static size_t buffer_size() {return __deque_buffer_size<T, B_SIZE>::value;}
 
             deque_iterator() : cur(0), buffer_start(0), buffer_finish(0), node(0) {}
            
             deque_iterator(T* c, T* bs, T* bf, T** n) : cur(c), buffer_start(bs), buffer_finish(bf), node(n) {}
 
-            deque_iterator(const deque_iterator& it) :
+            // copy, and iterator to const_iterator
+            deque_iterator(const iterator& it) :
                 cur(it.cur),
                 buffer_start(it.buffer_start),
                 buffer_finish(it.buffer_finish),
@@ -146,10 +172,76 @@ namespace ZJ {
 
     };
 
+    // each buffer is one run for the segmented algorithms (ZJ_utils.h)
+    template <typename T, typename Ptr, typename Ref, size_t B_SIZE>
+    struct segmented_iterator<deque_iterator<T, Ptr, Ref, B_SIZE>> {
+        typedef TRUE_TAG                                type;
+        typedef deque_iterator<T, Ptr, Ref, B_SIZE>     iterator;
+        typedef Ptr                                     pointer;
+
+        static pointer local(const iterator& it) {return it.cur;}
+
+        static pointer segment_end(const iterator& it) {return it.buffer_finish;}
+
+        static iterator next_segment(const iterator& it) {
+            T* b = it.node[1];
+            return iterator(b, b, b + iterator::buffer_size(), it.node + 1);
+        }
+    };
+
+    /**
+     * ZJ_relocate / ZJ_relocate_backward between deque iterators, one
+     * contiguous run at a time: a run ends where the source or the destination
+     * buffer ends, and each run goes through the pointer version (a memmove
+     * for trivially relocatable T), so buffer boundaries are checked once per
+     * run instead of once per element. Overlapping ranges work as with memmove
+     * when dest is before first (forward) or after it (backward).
+    */
+    template <typename T, size_t B_SIZE>
+    inline deque_iterator<T, T*, T&, B_SIZE> ZJ_relocate(deque_iterator<T, T*, T&, B_SIZE> first,
+                                                         deque_iterator<T, T*, T&, B_SIZE> last,
+                                                         deque_iterator<T, T*, T&, B_SIZE> dest) {
+        ptrdiff_t n = last - first;
+        while(n > 0) {
+            ptrdiff_t run = first.buffer_finish - first.cur;
+            if(dest.buffer_finish - dest.cur < run) run = dest.buffer_finish - dest.cur;
+            if(n < run) run = n;
+            ZJ_relocate(first.cur, first.cur + run, dest.cur);
+            first += run;
+            dest += run;
+            n -= run;
+        }
+        return dest;
+    }
+
+    template <typename T, size_t B_SIZE>
+    inline deque_iterator<T, T*, T&, B_SIZE> ZJ_relocate_backward(deque_iterator<T, T*, T&, B_SIZE> first,
+                                                                  deque_iterator<T, T*, T&, B_SIZE> last,
+                                                                  deque_iterator<T, T*, T&, B_SIZE> dest_last) {
+        const ptrdiff_t bs = deque_iterator<T, T*, T&, B_SIZE>::buffer_size();
+        ptrdiff_t n = last - first;
+        while(n > 0) {
+            // at the start of a buffer, the run is the end of the previous one
+            T* src_end = last.cur != last.buffer_start ? last.cur : *(last.node - 1) + bs;
+            T* dest_end = dest_last.cur != dest_last.buffer_start ? dest_last.cur : *(dest_last.node - 1) + bs;
+            ptrdiff_t run = last.cur != last.buffer_start ? last.cur - last.buffer_start : bs;
+            ptrdiff_t dest_run = dest_last.cur != dest_last.buffer_start ? dest_last.cur - dest_last.buffer_start : bs;
+            if(dest_run < run) run = dest_run;
+            if(n < run) run = n;
+            ZJ_relocate_backward(src_end - run, src_end, dest_end);
+            last -= run;
+            dest_last -= run;
+            n -= run;
+        }
+        return dest_last;
+    }
+
+    // B_SIZE: elements per buffer, 0 for ZJ_DEQUE_BUFFER_BYTES worth (deque_buffer_bytes)
     template <typename T, size_t B_SIZE = 0, typename Alloc = allocator<T>>
-    class deque {
+    class deque : protected Alloc {
         public : 
             typedef T                                               value_type;
+            typedef Alloc                                           allocator_type;
             typedef T*                                              pointer;
             typedef deque_iterator<T, T*, T&, B_SIZE>               iterator;
             typedef deque_iterator<T, const T*, const T&, B_SIZE>   const_iterator;
@@ -159,25 +251,70 @@ namespace ZJ {
             typedef ptrdiff_t                                       difference_type;
 
         protected : 
-            typedef Alloc               deque_allocator;
-            typedef pointer*            map_pointer;
-            typedef Alloc               data_allocator;
-            typedef allocator<pointer>  map_allocator;
+            typedef Alloc                                           deque_allocator;
+            typedef pointer*                                        map_pointer;
+            typedef Alloc                                           data_allocator;
+            typedef typename alloc_rebind<Alloc, pointer>::other    map_allocator;
             
-            static size_t buffer_size() {return B_SIZE != 0 ? B_SIZE : (sizeof(T) < 512 ? 512 / sizeof(T) : 1);}
+            static size_t buffer_size() {return __deque_buffer_size<T, B_SIZE>::value;}
+
+            // buffers freed at one end are kept here and taken by the other end,
+            // so a queue sliding through the map stops calling the allocator
+            enum {MAX_SPARE_BUFFERS = 4};
 
             iterator start;
             iterator finish;
             map_pointer map;
             size_type map_size;
+            pointer spare[MAX_SPARE_BUFFERS];
+            size_type num_spare;
             
 
         public : 
             deque() {fill_initialize();}
 
+            explicit deque(const Alloc& a) : Alloc(a) {fill_initialize();}
+
             deque(size_type n) {fill_initialize(n, value_type());}
 
-            deque(size_type n, const value_type& value) {fill_initialize(n, value);}
+            deque(size_type n, const value_type& value, const Alloc& a = Alloc()) : Alloc(a) {fill_initialize(n, value);}
+
+            deque(const deque& d) : Alloc(d.get_allocator()) {
+                fill_initialize();
+                insert(finish, d.begin(), d.end());
+            }
+
+            // d is left empty, with a map and a buffer of its own
+            deque(deque&& d) : Alloc(d.get_allocator()) {
+                fill_initialize();
+                swap(d);
+            }
+
+            ~deque() {
+                ZJ_destroy(start, finish);
+                for(map_pointer ptr = start.node; ptr <= finish.node; ++ptr)
+                    data_allocator::deallocate(*ptr, buffer_size());
+                shrink_to_fit();
+                get_map_allocator().deallocate(map, map_size);
+            }
+
+            deque& operator= (const deque& rhs) {
+                if(this != &rhs) {
+                    deque tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            deque& operator= (deque&& rhs) {
+                if(this != &rhs) {
+                    deque tmp(std::move(rhs));
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return *static_cast<const Alloc*>(this);}
 
             iterator begin() {return start;}
 
@@ -205,29 +342,56 @@ namespace ZJ {
 
             bool empty() const {return start == finish;}
 
+            // gives the spare buffers back to the allocator
+            void shrink_to_fit() {
+                while(num_spare > 0) data_allocator::deallocate(spare[--num_spare], buffer_size());
+            }
+
+            void swap(deque& rhs) {
+                ZJ_swap(static_cast<Alloc&>(*this), static_cast<Alloc&>(rhs));
+                ZJ_swap(start, rhs.start);
+                ZJ_swap(finish, rhs.finish);
+                ZJ_swap(map, rhs.map);
+                ZJ_swap(map_size, rhs.map_size);
+                for(size_type i = 0; i < MAX_SPARE_BUFFERS; ++i) ZJ_swap(spare[i], rhs.spare[i]);
+                ZJ_swap(num_spare, rhs.num_spare);
+            }
+
             void push_back(const value_type& value) {
-                if(finish.cur == finish.buffer_finish - 1) {
-                    if(finish.node == map + map_size - 1) map_expand(1, false);
-                    *(finish.node + 1) = data_allocator::allocate(buffer_size());
-                }
-                ZJ_construct(finish, value);
+                emplace_back(value);
+            }
+
+            void push_back(value_type&& value) {
+                emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_back(Args&&... args) {
+                reserve_slot_back();
+                ZJ_construct(finish, std::forward<Args>(args)...);
                 ++finish;
             }
 
             void push_front(const value_type& value) { 
-                if(start.cur == start.buffer_start) {
-                    if(start.node == map) map_expand(1, true);
-                    *(start.node - 1) = data_allocator::allocate(buffer_size());
-                }
+                emplace_front(value);
+            }
+
+            void push_front(value_type&& value) { 
+                emplace_front(std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_front(Args&&... args) { 
+                reserve_slot_front();
+                ZJ_construct(start - 1, std::forward<Args>(args)...);  
                 --start;
-                ZJ_construct(start, value);  
             }
 
             void pop_back() {
                 if(finish.cur == finish.buffer_start) {
                     map_pointer tmp = finish.node;
                     --finish;
-                    data_allocator::deallocate(*tmp, sizeof(*tmp));
+                    deallocate_buffer(*tmp);
                     *tmp = nullptr;
                     ZJ_destroy(finish);
                 }
@@ -242,7 +406,7 @@ namespace ZJ {
                     map_pointer tmp = start.node;
                     ++start;
                     ZJ_destroy(start - 1);
-                    data_allocator::deallocate(*tmp, sizeof(*tmp));
+                    deallocate_buffer(*tmp);
                     *tmp = nullptr;
                 }
                 else {
@@ -252,97 +416,82 @@ namespace ZJ {
             }
 
             iterator insert(iterator pos, const value_type& value) { 
-                return insert(pos, 1, value);
-                /*
-                difference_type index = pos - start;
-                if(start == finish) {
-                    push_back(value);
+                return emplace(pos, value);
+            }
+
+            iterator insert(iterator pos, value_type&& value) { 
+                return emplace(pos, std::move(value));
+            }
+
+            // one element at pos, the shorter side is relocated by one
+            template <typename... Args>
+            iterator emplace(iterator pos, Args&&... args) {
+                if(pos.cur == start.cur) {
+                    emplace_front(std::forward<Args>(args)...);
                     return start;
                 }
-                else if(index < size() / 2) {
-                    push_front(front());
-                    move_data(start + 1, start + 1 + index, start);
-                    ZJ_construct(start + index, value);
-                    return start + index;
+                if(pos.cur == finish.cur) {
+                    emplace_back(std::forward<Args>(args)...);
+                    return finish - 1;
+                }
+                value_type tmp(std::forward<Args>(args)...);
+                difference_type index = pos - start;
+                if((size_type)index < size() / 2) {
+                    reserve_slot_front();
+                    ZJ_relocate(start, start + index, start - 1);
+                    --start;
                 }
                 else {
-                    index = finish - pos;
-                    push_back(back());
-                    move_data(finish - 1 - index, finish - 1, finish - index);
-                    ZJ_construct(finish - 1 - index, value);
-                    return finish - 1 - index;
+                    reserve_slot_back();
+                    ZJ_relocate_backward(start + index, finish, finish + 1);
+                    ++finish;
                 }
-                */
+                ZJ_construct(start + index, std::move(tmp));
+                return start + index;
             }
 
+            // n copies of value at pos, the shorter side is relocated by n
             iterator insert(iterator pos, size_type n, const value_type& value) {
-                difference_type index = pos - start;
-                size_t bs = buffer_size();
-                if (start == finish) {
-                    push_back(value);
-                    return insert(finish, n - 1, value);
-                }
-                else if(index < size() / 2) { 
-                    size_type remaining = left_space();
-                    if(remaining <= n) 
-                        map_expand((n - remaining) / bs + 1, true);
-                    if(n > start.cur - start.buffer_start)
-                        alloc_buffer_left((n - (start.cur - start.buffer_start) - 1) / bs + 1); 
-                    move_data(start, start + index, start - n);
-                    ZJ_uninitialized_fill_n(start + index - n, n, value);
-                    start -= n;
-                    return start + index + n;
-                } 
-                else { index = finish - pos;
-                    size_type remaining = right_space();
-                    if(remaining <= n) 
-                        map_expand((n - remaining) / bs + 1, false);
-                    if(n > finish.buffer_finish - finish.cur - 1) 
-                        alloc_buffer_right((n - (finish.buffer_finish - finish.cur)) / bs + 1);
-                    move_data(finish - index, finish, finish - index + n);
-                    ZJ_uninitialized_fill_n(finish - index, n, value);
-                    finish += n;
-                    return finish - index;
-                }
+                if(n == 0) return pos;
+                value_type tmp(value); // value may be an element of this deque
+                iterator gap = open_gap(pos - start, n);
+                ZJ_uninitialized_fill_n(gap, n, tmp);
+                return gap;
+            }
+
+            // any iterator type; [first, last) may be part of this deque or an input stream
+            template <typename InputIterator>
+            iterator insert(iterator pos, InputIterator first, InputIterator last) {
+                return insert_dispatch(pos, first, last, typename bool_tag<std::is_integral<InputIterator>::value>::type());
             }
 
-            // to be implemented: allow general iterator input
-            //iterator insert(iterator first, iterator last, iterator dest) {}
             iterator erase(iterator pos) { // does not shrink 
                 return erase(pos, pos + 1);
-                /*
-                difference_type index = pos - start;
-                if(index < size() / 2) {
-                    move_data(start, pos, start + 1);
-                    ++start;
-                    ZJ_destroy(start - 1);
-                }
-                else {
-                    move_data(pos + 1, finish, pos);
-                    --finish;
-                    ZJ_destroy(finish);
-                }
-                */
             }
 
+            // the shorter side is relocated over the hole, buffers left empty are freed
             iterator erase(iterator first, iterator last) {
                 difference_type left_part = first - start;
                 difference_type right_part = finish - last;
                 difference_type n = last - first;
+                if(n == 0) return first;
+                ZJ_destroy(first, last);
                 if(left_part < right_part) {
                     iterator new_start = start + n;
-                    ZJ_copy(start, first, start + n, false);
-                    ZJ_destroy(start, new_start);
-                    for(map_pointer ptr = start.node; ptr < new_start.node; ++ptr)
-                        data_allocator::deallocate(*ptr, buffer_size());
+                    ZJ_relocate_backward(start, first, last);
+                    for(map_pointer ptr = start.node; ptr < new_start.node; ++ptr) {
+                        deallocate_buffer(*ptr);
+                        *ptr = nullptr;
+                    }
                     start = new_start;
                 }
                 else {
                     iterator new_finish = finish - n;
-                    ZJ_copy(last, finish, last - n, true);
-                    ZJ_destroy(new_finish, finish);
-                    for(map_pointer ptr = new_finish.node + 1; ptr <= finish.node; ++ptr)
-                        data_allocator::deallocate(*ptr, buffer_size());
+                    ZJ_relocate(last, finish, first);
+                    for(map_pointer ptr = new_finish.node + 1; ptr <= finish.node; ++ptr) {
+                        deallocate_buffer(*ptr);
+                        *ptr = nullptr;
+                    }
                     finish = new_finish;
                 }
                 return start + left_part;
@@ -358,6 +507,8 @@ namespace ZJ {
             void fill_initialize() {
                 // default map size 5
                 size_t bs = buffer_size();
+                num_spare = 0;
+                for(size_type i = 0; i < MAX_SPARE_BUFFERS; ++i) spare[i] = nullptr;
                 map_size = 5;
                 map = create_map(map_size);
                 pointer res = data_allocator::allocate(bs);
@@ -371,6 +522,8 @@ namespace ZJ {
             void fill_initialize(size_type n, const value_type& value) {
                 size_t bs = buffer_size();
                 difference_type map_start = 2;
+                num_spare = 0;
+                for(size_type i = 0; i < MAX_SPARE_BUFFERS; ++i) spare[i] = nullptr;
                 map_size = n / bs + 1 + 2 * map_start;
                 map = create_map(map_size);
                 for(int i=0; i<map_size; i++) 
@@ -383,69 +536,193 @@ namespace ZJ {
                 ZJ_uninitialized_fill_n(start, n, value);
             }
 
+            map_allocator get_map_allocator() const {return map_allocator(get_allocator());}
+
             map_pointer create_map(size_type n_nodes) {
-                return map_allocator::allocate(n_nodes);
+                return get_map_allocator().allocate(n_nodes);
             }
 
+            // called when one end of the map is reached
             void map_expand(size_type n_nodes = 1, bool insert_to_left = true) {
                 size_type new_map_size = (finish.node - start.node) + n_nodes + 1;
                 difference_type map_start;
                 map_pointer new_map;
                 if(new_map_size * 2 < map_size) {
+                    // the deque slid to one end of a map that is at most half full:
+                    // recenter in place, with n_nodes free slots on the side that grows
                     map_start = (map_size - new_map_size) / 2;
+                    if(insert_to_left) map_start += n_nodes;
                     new_map = map;
-                    ZJ_copy(start.node, finish.node + 1, map + map_start, (start.node - (map + map_start)) > 0);
+                    ZJ_uninitialized_copy(start.node, finish.node + 1, map + map_start); // memmove
                 }
                 else {
-                    map_start = new_map_size / 2; // make space for data to be inserted
+                    // at least doubles, so a queue of steady length soon has a map it can recenter in
+                    size_type alloc_size = map_size + (map_size > n_nodes ? map_size : n_nodes) + 2;
+                    map_start = (alloc_size - new_map_size) / 2;
                     if(insert_to_left) map_start += n_nodes;
-                    new_map = map_allocator::allocate(2 * new_map_size);
-                    for(int i=0; i<2*new_map_size; i++) 
+                    new_map = get_map_allocator().allocate(alloc_size);
+                    for(size_type i=0; i<alloc_size; i++) 
                         new_map[i] = nullptr;
-                    ZJ_copy(start.node, finish.node + 1, new_map + map_start);
+                    ZJ_uninitialized_copy(start.node, finish.node + 1, new_map + map_start);
                     __ZJ_destroy(map, map + map_size, TRUE_TAG());
-                    map_allocator::deallocate(map, map_size);
+                    get_map_allocator().deallocate(map, map_size);
                     map = new_map;
-                    map_size = new_map_size * 2;
+                    map_size = alloc_size;
                 }
                 finish.node = new_map + map_start + (finish.node - start.node);
                 start.node = new_map + map_start;
             }
         
         protected : 
-            void move_data(iterator first, iterator last, iterator dest) {
-                difference_type n = dest - first;
-                if(n > 0) ZJ_copy(first, last, dest, false);
-                else ZJ_copy(first, last, dest, true);
+            pointer allocate_buffer() {
+                if(num_spare > 0) return spare[--num_spare];
+                return data_allocator::allocate(buffer_size());
             }
 
-            size_type left_space() const {
-                size_t bs = buffer_size();
-                return (start.node - map) * bs + (start.cur - start.buffer_start);
+            void deallocate_buffer(pointer p) {
+                if(num_spare < MAX_SPARE_BUFFERS) spare[num_spare++] = p;
+                else data_allocator::deallocate(p, buffer_size());
+            }
+
+            // makes sure the slot before start has a buffer
+            void reserve_slot_front() {
+                if(start.cur == start.buffer_start) {
+                    if(start.node == map) map_expand(1, true);
+                    *(start.node - 1) = allocate_buffer();
+                }
+            }
+
+            // makes sure the slot after finish has a buffer (finish itself always has one)
+            void reserve_slot_back() {
+                if(finish.cur == finish.buffer_finish - 1) {
+                    if(finish.node == map + map_size - 1) map_expand(1, false);
+                    *(finish.node + 1) = allocate_buffer();
+                }
             }
 
-            size_type right_space() const {
+            // makes sure the n slots before start have buffers
+            void reserve_elements_front(size_type n) {
+                size_type vacancies = start.cur - start.buffer_start;
+                if(n <= vacancies) return ;
                 size_t bs = buffer_size();
-                return (map_size - 1 - (finish.node - map)) * bs + (finish.buffer_finish - finish.cur);
+                size_type new_nodes = (n - vacancies + bs - 1) / bs;
+                if(new_nodes > (size_type)(start.node - map)) map_expand(new_nodes, true);
+                for(size_type i = 1; i <= new_nodes; ++i)
+                    *(start.node - i) = allocate_buffer();
             }
 
-            void alloc_buffer_left(size_t n) {
+            // makes sure the n slots from finish on have buffers, and finish + n too
+            void reserve_elements_back(size_type n) {
+                size_type vacancies = finish.buffer_finish - finish.cur - 1;
+                if(n <= vacancies) return ;
                 size_t bs = buffer_size();
-                map_pointer mptr = start.node - 1;
-                for(; n > 0; --n){
-                    *mptr = data_allocator::allocate(bs);
-                    --mptr;
+                size_type new_nodes = (n - vacancies + bs - 1) / bs;
+                if(new_nodes > (size_type)(map + map_size - 1 - finish.node)) map_expand(new_nodes, false);
+                for(size_type i = 1; i <= new_nodes; ++i)
+                    *(finish.node + i) = allocate_buffer();
+            }
+
+            // n raw slots at index: the shorter side is relocated away, run by run;
+            // returns the first slot, which the caller constructs
+            iterator open_gap(size_type index, size_type n) {
+                if(index < size() / 2) {
+                    reserve_elements_front(n);
+                    iterator new_start = start - n;
+                    ZJ_relocate(start, start + index, new_start);
+                    start = new_start;
+                }
+                else {
+                    reserve_elements_back(n);
+                    ZJ_relocate_backward(start + index, finish, finish + n);
+                    finish += n;
+                }
+                return start + index;
+            }
+
+            // random access sources are copied run by run (a memmove from contiguous ones)
+            template <typename ForwardIterator>
+            void copy_gap(iterator dest, ForwardIterator first, size_type n, TRUE_TAG) {
+                while(n > 0) {
+                    size_type run = dest.buffer_finish - dest.cur;
+                    if(n < run) run = n;
+                    ZJ_uninitialized_copy(first, first + run, dest.cur);
+                    first += run;
+                    dest += run;
+                    n -= run;
                 }
             }
 
-            void alloc_buffer_right(size_t n) {
-                size_t bs = buffer_size();
-                map_pointer mptr = finish.node + 1;
-                for(; n > 0; n--){
-                    *mptr = data_allocator::allocate(bs);
-                    ++mptr;
+            template <typename ForwardIterator>
+            void copy_gap(iterator dest, ForwardIterator first, size_type n, FALSE_TAG) {
+                for(; n > 0; --n, ++first, ++dest)
+                    ZJ_construct(dest, *first);
+            }
+
+            // insert(pos, 3, 5) with ints lands in the template, it means 3 copies of 5
+            template <typename Integer>
+            iterator insert_dispatch(iterator pos, Integer n, Integer value, TRUE_TAG) {
+                return insert(pos, (size_type)n, (value_type)value);
+            }
+
+            template <typename InputIterator>
+            iterator insert_dispatch(iterator pos, InputIterator first, InputIterator last, FALSE_TAG) {
+                return range_insert(pos, first, last, typename is_forward_iterator<InputIterator>::type());
+            }
+
+            // forward iterators: the length is known, one gap is opened and filled in place
+            template <typename ForwardIterator>
+            iterator range_insert(iterator pos, ForwardIterator first, ForwardIterator last, TRUE_TAG) {
+                size_type n = ZJ_distance(first, last);
+                if(n == 0) return pos;
+                typedef typename bool_tag<std::is_same<ForwardIterator, iterator>::value ||
+                                          std::is_same<ForwardIterator, const_iterator>::value>::type own_iterator;
+                if(in_storage(first, own_iterator())) {
+                    // [first, last) is part of this deque and would move under the copy
+                    vector<value_type, Alloc> tmp(get_allocator());
+                    tmp.reserve(n);
+                    for(; first != last; ++first) tmp.emplace_back(*first);
+                    return move_insert(pos, tmp);
                 }
+                iterator gap = open_gap(pos - start, n);
+                copy_gap(gap, first, n, typename is_random_access_iterator<ForwardIterator>::type());
+                return gap;
             }
+
+            // input iterators can only be read once: collected first, then moved in
+            template <typename InputIterator>
+            iterator range_insert(iterator pos, InputIterator first, InputIterator last, FALSE_TAG) {
+                size_type index = pos - start;
+                if(pos == finish) {
+                    for(; first != last; ++first) emplace_back(*first);
+                    return start + index;
+                }
+                vector<value_type, Alloc> tmp(get_allocator());
+                for(; first != last; ++first) tmp.emplace_back(*first);
+                return move_insert(pos, tmp);
+            }
+
+            // moves v's elements in front of pos, v keeps them moved from
+            iterator move_insert(iterator pos, vector<value_type, Alloc>& v) {
+                size_type n = v.size();
+                if(n == 0) return pos;
+                iterator gap = open_gap(pos - start, n);
+                pointer src = v.data();
+                for(iterator dest = gap; n > 0; ) {
+                    size_type run = dest.buffer_finish - dest.cur;
+                    if(n < run) run = n;
+                    ZJ_uninitialized_move(src, src + run, dest.cur);
+                    src += run;
+                    dest += run;
+                    n -= run;
+                }
+                return gap;
+            }
+
+            template <typename Iter>
+            bool in_storage(Iter it, TRUE_TAG) const {return it.node >= start.node && it.node <= finish.node;}
+
+            template <typename Iter>
+            bool in_storage(Iter it, FALSE_TAG) const {return false;}
     };
 
 }
@@ -0,0 +1,355 @@
+
+
+
+#ifndef _ZJ_DYNAMIC_BITSET_
+#define _ZJ_DYNAMIC_BITSET_
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include "ZJ_alloc.h"
+#include "ZJ_vector.h"
+
+namespace ZJ {
+
+    /**
+     * Bits packed into 64-bit words, one bit per flag instead of the byte
+     * vector<bool> takes. Whole-word operations: set / reset / flip of all
+     * bits or of a range, count with popcount, find_first / find_next with
+     * tzcnt, and &= |= ^= -= as plain loops over the words, which the
+     * compiler vectorizes. Binary operations expect bitsets of the same size.
+     * Bits past size() in the last word are always zero.
+     *
+     *      dynamic_bitset<> visited(n);
+     *      for(size_t i = mask.find_first(); i != mask.npos; i = mask.find_next(i)) ...
+    */
+    template <typename Alloc = allocator<uint64_t>>
+    class dynamic_bitset {
+        public :
+            typedef uint64_t    word_type;
+            typedef size_t      size_type;
+            typedef typename alloc_rebind<Alloc, word_type>::other allocator_type;
+
+            enum {BITS_PER_WORD = sizeof(word_type) * CHAR_BIT};
+
+            static const size_type npos = (size_type)-1;
+
+            // proxy for one bit, what operator[] returns
+            class reference {
+                friend class dynamic_bitset;
+
+                private :
+                    word_type* word;
+                    word_type mask;
+
+                    reference(word_type* w, word_type m) : word(w), mask(m) {}
+
+                public :
+                    reference& operator= (bool value) {
+                        if(value) *word |= mask;
+                        else *word &= ~mask;
+                        return *this;
+                    }
+
+                    reference& operator= (const reference& rhs) {return *this = (bool)rhs;}
+
+                    operator bool() const {return (*word & mask) != 0;}
+
+                    bool operator~ () const {return (*word & mask) == 0;}
+
+                    reference& flip() {
+                        *word ^= mask;
+                        return *this;
+                    }
+            };
+
+        protected :
+            vector<word_type, allocator_type> words;
+            size_type num_bits;
+
+        public :
+            dynamic_bitset() : words(), num_bits(0) {}
+
+            explicit dynamic_bitset(size_type n, bool value = false, const allocator_type& a = allocator_type())
+                : words(words_for(n), value ? ~(word_type)0 : 0, a), num_bits(n) {
+                zero_unused_bits();
+            }
+
+            size_type size() const {return num_bits;}
+
+            bool empty() const {return num_bits == 0;}
+
+            size_type num_words() const {return words.size();}
+
+            size_type capacity() const {return words.capacity() * BITS_PER_WORD;}
+
+            void reserve(size_type n) {words.reserve(words_for(n));}
+
+            // the words themselves, num_words() of them, for serialization
+            word_type* data() {return words.data();}
+
+            const word_type* data() const {return words.data();}
+
+            bool test(size_type pos) const {return (words[word_index(pos)] & bit_mask(pos)) != 0;}
+
+            bool operator[] (size_type pos) const {return test(pos);}
+
+            reference operator[] (size_type pos) {return reference(&words[word_index(pos)], bit_mask(pos));}
+
+            dynamic_bitset& set(size_type pos) {
+                words[word_index(pos)] |= bit_mask(pos);
+                return *this;
+            }
+
+            dynamic_bitset& set(size_type pos, bool value) {
+                return value ? set(pos) : reset(pos);
+            }
+
+            dynamic_bitset& reset(size_type pos) {
+                words[word_index(pos)] &= ~bit_mask(pos);
+                return *this;
+            }
+
+            dynamic_bitset& flip(size_type pos) {
+                words[word_index(pos)] ^= bit_mask(pos);
+                return *this;
+            }
+
+            // all bits
+            dynamic_bitset& set() {
+                fill_words(~(word_type)0);
+                zero_unused_bits();
+                return *this;
+            }
+
+            dynamic_bitset& reset() {
+                fill_words(0);
+                return *this;
+            }
+
+            dynamic_bitset& flip() {
+                word_type* w = words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] = ~w[i];
+                zero_unused_bits();
+                return *this;
+            }
+
+            // bits [first, last), edge words masked, whole words in between
+            dynamic_bitset& set_range(size_type first, size_type last) {
+                range_apply(first, last, set_op());
+                return *this;
+            }
+
+            dynamic_bitset& reset_range(size_type first, size_type last) {
+                range_apply(first, last, reset_op());
+                return *this;
+            }
+
+            dynamic_bitset& flip_range(size_type first, size_type last) {
+                range_apply(first, last, flip_op());
+                return *this;
+            }
+
+            size_type count() const {
+                const word_type* w = words.data();
+                size_type res = 0;
+                for(size_type i = 0, n = num_words(); i < n; ++i) res += __ZJ_popcount64(w[i]);
+                return res;
+            }
+
+            bool any() const {
+                const word_type* w = words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i)
+                    if(w[i]) return true;
+                return false;
+            }
+
+            bool none() const {return !any();}
+
+            bool all() const {return count() == num_bits;}
+
+            // lowest set bit, npos if none
+            size_type find_first() const {return find_from(0);}
+
+            // lowest set bit after pos, npos if none
+            size_type find_next(size_type pos) const {
+                if(pos + 1 >= num_bits) return npos;
+                ++pos;
+                word_type w = words[word_index(pos)] & (~(word_type)0 << bit_index(pos));
+                if(w) return word_index(pos) * BITS_PER_WORD + __ZJ_ctz64(w);
+                return find_from(word_index(pos) + 1);
+            }
+
+            void push_back(bool value) {
+                if(num_bits % BITS_PER_WORD == 0) words.push_back(0);
+                ++num_bits;
+                if(value) set(num_bits - 1);
+            }
+
+            void pop_back() {
+                reset(num_bits - 1);
+                --num_bits;
+                if(num_bits % BITS_PER_WORD == 0) words.pop_back();
+            }
+
+            // new bits get value
+            void resize(size_type n, bool value = false) {
+                size_type old_bits = num_bits;
+                size_type new_words = words_for(n);
+                if(new_words > num_words()) words.insert(words.end(), new_words - num_words(), value ? ~(word_type)0 : 0);
+                else if(new_words < num_words()) words.erase(words.begin() + new_words, words.end());
+                num_bits = n;
+                if(value && n > old_bits) range_apply(old_bits, n, set_op());
+                zero_unused_bits();
+            }
+
+            void clear() {
+                words.clear();
+                num_bits = 0;
+            }
+
+            void swap(dynamic_bitset& rhs) {
+                words.swap(rhs.words);
+                ZJ_swap(num_bits, rhs.num_bits);
+            }
+
+            dynamic_bitset& operator&= (const dynamic_bitset& rhs) {
+                word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] &= r[i];
+                return *this;
+            }
+
+            dynamic_bitset& operator|= (const dynamic_bitset& rhs) {
+                word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] |= r[i];
+                return *this;
+            }
+
+            dynamic_bitset& operator^= (const dynamic_bitset& rhs) {
+                word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] ^= r[i];
+                return *this;
+            }
+
+            // and not: clears the bits set in rhs
+            dynamic_bitset& operator-= (const dynamic_bitset& rhs) {
+                word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] &= ~r[i];
+                return *this;
+            }
+
+            dynamic_bitset operator~ () const {
+                dynamic_bitset res(*this);
+                res.flip();
+                return res;
+            }
+
+            // any bit set in both
+            bool intersects(const dynamic_bitset& rhs) const {
+                const word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i)
+                    if(w[i] & r[i]) return true;
+                return false;
+            }
+
+            bool operator== (const dynamic_bitset& rhs) const {
+                if(num_bits != rhs.num_bits) return false;
+                const word_type* w = words.data();
+                const word_type* r = rhs.words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i)
+                    if(w[i] != r[i]) return false;
+                return true;
+            }
+
+            bool operator!= (const dynamic_bitset& rhs) const {return !(*this == rhs);}
+
+        protected :
+            struct set_op {
+                void operator() (word_type& w, word_type mask) const {w |= mask;}
+            };
+
+            struct reset_op {
+                void operator() (word_type& w, word_type mask) const {w &= ~mask;}
+            };
+
+            struct flip_op {
+                void operator() (word_type& w, word_type mask) const {w ^= mask;}
+            };
+
+            static size_type words_for(size_type n) {return (n + BITS_PER_WORD - 1) / BITS_PER_WORD;}
+
+            static size_type word_index(size_type pos) {return pos / BITS_PER_WORD;}
+
+            static size_type bit_index(size_type pos) {return pos % BITS_PER_WORD;}
+
+            static word_type bit_mask(size_type pos) {return (word_type)1 << bit_index(pos);}
+
+            void fill_words(word_type value) {
+                word_type* w = words.data();
+                for(size_type i = 0, n = num_words(); i < n; ++i) w[i] = value;
+            }
+
+            void zero_unused_bits() {
+                if(bit_index(num_bits)) words[num_words() - 1] &= ~(~(word_type)0 << bit_index(num_bits));
+            }
+
+            // lowest set bit in words [first_word, num_words())
+            size_type find_from(size_type first_word) const {
+                const word_type* w = words.data();
+                for(size_type i = first_word, n = num_words(); i < n; ++i)
+                    if(w[i]) return i * BITS_PER_WORD + __ZJ_ctz64(w[i]);
+                return npos;
+            }
+
+            template <typename Op>
+            void range_apply(size_type first, size_type last, Op op) {
+                if(first >= last) return ;
+                size_type fw = word_index(first), lw = word_index(last - 1);
+                word_type first_mask = ~(word_type)0 << bit_index(first);
+                word_type last_mask = ~(word_type)0 >> (BITS_PER_WORD - 1 - bit_index(last - 1));
+                word_type* w = words.data();
+                if(fw == lw) {
+                    op(w[fw], first_mask & last_mask);
+                    return ;
+                }
+                op(w[fw], first_mask);
+                for(size_type i = fw + 1; i < lw; ++i) op(w[i], ~(word_type)0);
+                op(w[lw], last_mask);
+            }
+    };
+
+    template <typename Alloc>
+    const typename dynamic_bitset<Alloc>::size_type dynamic_bitset<Alloc>::npos;
+
+    template <typename Alloc>
+    inline dynamic_bitset<Alloc> operator& (const dynamic_bitset<Alloc>& a, const dynamic_bitset<Alloc>& b) {
+        dynamic_bitset<Alloc> res(a);
+        return res &= b;
+    }
+
+    template <typename Alloc>
+    inline dynamic_bitset<Alloc> operator| (const dynamic_bitset<Alloc>& a, const dynamic_bitset<Alloc>& b) {
+        dynamic_bitset<Alloc> res(a);
+        return res |= b;
+    }
+
+    template <typename Alloc>
+    inline dynamic_bitset<Alloc> operator^ (const dynamic_bitset<Alloc>& a, const dynamic_bitset<Alloc>& b) {
+        dynamic_bitset<Alloc> res(a);
+        return res ^= b;
+    }
+
+    template <typename Alloc>
+    inline dynamic_bitset<Alloc> operator- (const dynamic_bitset<Alloc>& a, const dynamic_bitset<Alloc>& b) {
+        dynamic_bitset<Alloc> res(a);
+        return res -= b;
+    }
+
+}
+
+#endif
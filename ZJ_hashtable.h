@@ -57,36 +57,37 @@ namespace ZJ {
         Value data;
     };
 
-    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc = allocator<hashtable_node<Value>>>
+    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc = allocator<Value>>
     class hashtable;
-    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals>
+    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc>
     class hashtable_iterator;
-    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals>
+    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc>
     class hashtable_const_iterator;
 
-    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals>
+    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc>
     class hashtable_iterator {
 
-        friend class hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>;
+        friend class hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>;
         public : 
-            typedef hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals> self;
+            typedef hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc> self;
             typedef hashtable_node<Value>       node;
             typedef Value                       value_type;
             typedef Value&                      reference;
             typedef Value*                      pointer;
             typedef ptrdiff_t                   difference_type;
             typedef size_t                      size_type;
+            typedef forward_iterator_tag        iterator_category;
 
             //typedef node*                       node_pointer;
 
         private :
             node* cur;
-            hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals>* ht;
+            hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>* ht;
         
         public : 
             hashtable_iterator() {}
 
-            hashtable_iterator(node* c, hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals>* h) : cur(c), ht(h) {}
+            hashtable_iterator(node* c, hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>* h) : cur(c), ht(h) {}
 
             hashtable_iterator(const self& h_it) : cur(h_it.cur), ht(h_it.ht) {}
 
@@ -122,32 +123,33 @@ namespace ZJ {
             }
     };
 
-    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals>
+    template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc>
     class hashtable_const_iterator {
 
         public : 
-            typedef hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals> self;
+            typedef hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc> self;
             typedef hashtable_node<Value>       node;
             typedef const Value                 value_type;
             typedef const Value&                reference;
             typedef const Value*                pointer;
             typedef ptrdiff_t                   difference_type;
             typedef size_t                      size_type;
+            typedef forward_iterator_tag        iterator_category;
 
             //typedef node*                       node_pointer;
 
         private :
             const node* cur;
-            const hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals>* ht;
+            const hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>* ht;
 
             //vector<node_pointer>* buckets;
         
         public : 
             hashtable_const_iterator() {}
 
-            hashtable_const_iterator(const node* c, const hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals>* h) : cur(c), ht(h) {}
+            hashtable_const_iterator(const node* c, const hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>* h) : cur(c), ht(h) {}
 
-            hashtable_const_iterator(const hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>& h_it) : cur(h_it.cur), ht(h_it.ht) {}
+            hashtable_const_iterator(const hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>& h_it) : cur(h_it.cur), ht(h_it.ht) {}
             
             hashtable_const_iterator(const self& h_it) : cur(h_it.cur), ht(h_it.ht) {}
 
@@ -183,8 +185,9 @@ namespace ZJ {
     };
 
     template <class Key, class Value, class HashFunc, class KeyOfValue, class KeyEquals, class Alloc>
-    class hashtable {
+    class hashtable : protected alloc_rebind<Alloc, hashtable_node<Value>>::other {
         public : 
+            typedef Alloc           allocator_type;
             typedef HashFunc        hasher;
             typedef KeyEquals       key_equal;
             typedef size_t          size_type;
@@ -196,11 +199,11 @@ namespace ZJ {
             typedef Value&          reference;
             typedef const Value&    const_reference;
 
-            typedef hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>         iterator;
-            typedef hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>   const_iterator;
+            typedef hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>         iterator;
+            typedef hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>   const_iterator;
         
-        friend class hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>;
-        friend class hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals>;
+        friend class hashtable_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>;
+        friend class hashtable_const_iterator<Key, Value, HashFunc, KeyOfValue, KeyEquals, Alloc>;
         
         private : 
             hasher hash;
@@ -208,9 +211,13 @@ namespace ZJ {
             KeyOfValue get_key;
 
             typedef hashtable_node<Value> node;
-            typedef Alloc node_allocator;
+            typedef typename alloc_rebind<Alloc, hashtable_node<Value>>::other node_allocator;
+            typedef typename alloc_rebind<Alloc, node*>::other bucket_allocator;
+            typedef typename tag_and<typename alloc_traits<node_allocator>::IS_MONOTONIC, 
+                                     typename traits<Value>::HAS_TRIVIAL_DESTRUCTOR>::type skip_nodes_tag;
+            typedef node_batch<node_allocator> node_source;
 
-            vector<node*> buckets;
+            vector<node*, bucket_allocator> buckets;
             size_type num_elements;
         
         public : 
@@ -218,16 +225,66 @@ namespace ZJ {
                 initialize_buckets(PRIME_LIST[0]);
             }
 
-            hashtable(size_type n, const HashFunc& hf, const KeyEquals& ke) : hash(hf), equals(ke), get_key(KeyOfValue()), num_elements(0) {
+            hashtable(size_type n, const HashFunc& hf, const KeyEquals& ke, const Alloc& a = Alloc()) : 
+                node_allocator(a), 
+                hash(hf), 
+                equals(ke), 
+                get_key(KeyOfValue()), 
+                buckets(bucket_allocator(a)), 
+                num_elements(0) 
+            {
                 initialize_buckets(n);
             }
 
-            hashtable(const hashtable& rhs) : hash(rhs.hash), equals(rhs.equals), get_key(rhs.get_key), num_elements(rhs.num_elements) {
-                buckets.reserve(rhs.buckets.capacity());
+            hashtable(const hashtable& rhs) : 
+                node_allocator(rhs), 
+                hash(rhs.hash), 
+                equals(rhs.equals), 
+                get_key(rhs.get_key), 
+                buckets(rhs.buckets.get_allocator()), 
+                num_elements(0) 
+            {
+                initialize_buckets(rhs.bucket_size());
+                node_source batch(*this);
                 for(const_iterator it = rhs.begin(); it != rhs.end(); ++it) 
-                    insert_equal(*it);
+                    insert_equal_aux(*it, &batch);
+            }
+
+            // takes rhs's nodes and bucket array, rhs is left with no buckets
+            // (lookups on it find nothing, its first insert sizes a new array)
+            hashtable(hashtable&& rhs) : 
+                node_allocator(rhs), 
+                hash(rhs.hash), 
+                equals(rhs.equals), 
+                get_key(rhs.get_key), 
+                buckets(std::move(rhs.buckets)), 
+                num_elements(rhs.num_elements) 
+            {
+                rhs.num_elements = 0;
+            }
+
+            ~hashtable() {
+                clear_nodes(skip_nodes_tag());
+            }
+
+            hashtable& operator= (const hashtable& rhs) {
+                if(this != &rhs) {
+                    hashtable tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            hashtable& operator= (hashtable&& rhs) {
+                if(this != &rhs) {
+                    clear();
+                    swap(rhs);
+                }
+                return *this;
             }
 
+            allocator_type get_allocator() const {return allocator_type(*static_cast<const node_allocator*>(this));}
+
             hasher hash_function() const {return hash;}
 
             key_equal key_eq() const {return equals;}
@@ -273,60 +330,60 @@ namespace ZJ {
             }
 
             pair<iterator, bool> insert_unique(const value_type& x) {
-                resize(num_elements + 1);
-                
-                Key kox = get_key(x);
-                size_type n = bucket_num_key(kox);
-                node* first = buckets[n];
-                for(node* cur = first; cur; cur = cur->next) {
-                    if(equals(get_key(cur->data), kox)) {
-                        return pair<iterator, bool>(iterator(cur, this), false);
-                    }
-                }
-                node* tmp = create_node(x);
-                tmp->next = first;
-                buckets[n] = tmp;
-                ++num_elements;
-                return pair<iterator, bool>(iterator(tmp, this), true);
+                return insert_unique_aux(x, 0);
             }
 
-            void insert_unique(iterator first, iterator last) {
+            pair<iterator, bool> insert_unique(value_type&& x) {
+                return insert_unique_aux(std::move(x), 0);
+            }
+
+            // nodes for a range come in batches when the allocator has a bulk allocate_n, see node_batch
+            template <typename InputIterator>
+            void insert_unique(InputIterator first, InputIterator last) {
+                node_source batch(*this);
                 for(; first != last; ++first) {
-                    insert_unique(*first);
+                    insert_unique_aux(*first, &batch);
                 }
             }
 
             iterator insert_equal(const value_type& x) {
+                return insert_equal_aux(x, 0);
+            }
+
+            iterator insert_equal(value_type&& x) {
+                return insert_equal_aux(std::move(x), 0);
+            }
+
+            template <typename InputIterator>
+            void insert_equal(InputIterator first, InputIterator last) {
+                node_source batch(*this);
+                for(; first != last; ++first) {
+                    insert_equal_aux(*first, &batch);
+                }
+            }
+
+            // the node is built first, the key comes from it
+            template <typename... Args>
+            pair<iterator, bool> emplace_unique(Args&&... args) {
+                node* tmp = create_node(0, std::forward<Args>(args)...);
                 resize(num_elements + 1);
-                
-                Key kox = get_key(x);
-                size_type n = bucket_num_key(kox);
-                node* first = buckets[n];
-                for(node* cur = first; cur; cur = cur->next) {
-                    // instead of inserting right here
-                    // which is also a valid way (and easier)
-                    // we find the first element that is equal to x
-                    // to maintain the stable ordering
-                    // plus this can make other functions easier (erase, equal_range, etc.)
-                    if(equals(get_key(cur->data), kox)) { 
-                        node* tmp = create_node(x);
-                        tmp->next = cur->next;
-                        cur->next = tmp;
-                        ++num_elements;
-                        return iterator(tmp, this);
+                const Key& k = get_key(tmp->data);
+                size_type n = bucket_num_key(k);
+                for(node* cur = buckets[n]; cur; cur = cur->next) {
+                    if(equals(get_key(cur->data), k)) {
+                        delete_node(tmp);
+                        return pair<iterator, bool>(iterator(cur, this), false);
                     }
                 }
-                node* tmp = create_node(x);
-                tmp->next = first;
+                tmp->next = buckets[n];
                 buckets[n] = tmp;
                 ++num_elements;
-                return iterator(tmp, this);
+                return pair<iterator, bool>(iterator(tmp, this), true);
             }
 
-            void insert_equal(iterator first, iterator last) {
-                for(; first != last; ++first) {
-                    insert_equal(*first);
-                }
+            template <typename... Args>
+            iterator emplace_equal(Args&&... args) {
+                return insert_equal_node(create_node(0, std::forward<Args>(args)...));
             }
 
             void erase(iterator it) {
@@ -361,6 +418,7 @@ namespace ZJ {
             }
 
             void erase(const key_type& k) {
+                if(empty()) return ;
                 size_type n = bucket_num_key(k);
                 node* first = buckets[n];
                 if(first) {
@@ -386,6 +444,7 @@ namespace ZJ {
             }
 
             pair<iterator, iterator> equal_range(const key_type& k) {
+                if(empty()) return pair<iterator, iterator>(end(), end());
                 size_type n = bucket_num_key(k);
                 for(node* cur = *(buckets.begin() + n); cur; cur = cur->next) 
                     if(equals(get_key(cur->data), k)){
@@ -401,6 +460,7 @@ namespace ZJ {
             }
 
             pair<const_iterator, const_iterator> equal_range(const key_type& k) const {
+                if(empty()) return pair<const_iterator, const_iterator>(end(), end());
                 size_type n = bucket_num_key(k);
                 for(node* cur = *(buckets.begin() + n); cur; cur = cur->next) 
                     if(equals(get_key(cur->data), k)){
@@ -416,6 +476,7 @@ namespace ZJ {
             }
 
             iterator find(const key_type& k) {
+                if(empty()) return end();
                 size_type n = bucket_num_key(k);
                 for(node* cur = *(buckets.begin() + n); cur; cur = cur->next) 
                     if(equals(get_key(cur->data), k))
@@ -424,6 +485,7 @@ namespace ZJ {
             }
 
             const_iterator find(const key_type& k) const {
+                if(empty()) return end();
                 size_type n = bucket_num_key(k);
                 for(node* cur = *(buckets.begin() + n); cur; cur = cur->next) 
                     if(equals(get_key(cur->data), k))
@@ -432,6 +494,7 @@ namespace ZJ {
             }
 
             size_type count(const key_type& k) const {
+                if(empty()) return 0;
                 size_type n = bucket_num_key(k);
                 size_type res = 0;
                 for(node* cur = *(buckets.begin() + n); cur; cur = cur->next)
@@ -441,19 +504,16 @@ namespace ZJ {
             }
 
             void clear() {
-                for(size_type i = 0; i < bucket_size(); ++i) {
-                    node* cur = buckets[i];
-                    while(cur) {
-                        node* next = cur->next;
-                        delete_node(cur);
-                        cur = next;
-                    }
+                clear_nodes(skip_nodes_tag());
+                for(size_type i = 0; i < bucket_size(); ++i)
                     buckets[i] = 0;
-                }
                 num_elements = 0;
             }
 
-            void swap(hashtable<Key, Value, HashFunc, KeyOfValue, KeyEquals>& rhs) {
+            void swap(hashtable& rhs) {
+                ZJ_swap(static_cast<node_allocator&>(*this), static_cast<node_allocator&>(rhs));
+                ZJ_swap(hash, rhs.hash);
+                ZJ_swap(equals, rhs.equals);
                 buckets.swap(rhs.buckets);
                 ZJ_swap(num_elements, rhs.num_elements);
             }
@@ -472,15 +532,80 @@ namespace ZJ {
             }
 
         protected : 
-            node* create_node(const value_type& x) {
-                node* res = node_allocator::allocate(1);
-                ZJ_construct(&(res->data), x);
+            // frees every node, the bucket array is left as it is
+            void clear_nodes(FALSE_TAG) {
+                for(size_type i = 0; i < bucket_size(); ++i) {
+                    node* cur = buckets[i];
+                    while(cur) {
+                        node* next = cur->next;
+                        delete_node(cur);
+                        cur = next;
+                    }
+                }
+            }
+
+            // monotonic allocator and nothing to destroy: the nodes are simply dropped
+            void clear_nodes(TRUE_TAG) {}
+
+            template <typename Arg>
+            pair<iterator, bool> insert_unique_aux(Arg&& x, node_source* batch) {
+                resize(num_elements + 1);
+                
+                const Key& kox = get_key(x);
+                size_type n = bucket_num_key(kox);
+                node* first = buckets[n];
+                for(node* cur = first; cur; cur = cur->next) {
+                    if(equals(get_key(cur->data), kox)) {
+                        return pair<iterator, bool>(iterator(cur, this), false);
+                    }
+                }
+                node* tmp = create_node(batch, std::forward<Arg>(x));
+                tmp->next = first;
+                buckets[n] = tmp;
+                ++num_elements;
+                return pair<iterator, bool>(iterator(tmp, this), true);
+            }
+
+            template <typename Arg>
+            iterator insert_equal_aux(Arg&& x, node_source* batch) {
+                return insert_equal_node(create_node(batch, std::forward<Arg>(x)));
+            }
+
+            iterator insert_equal_node(node* tmp) {
+                resize(num_elements + 1);
+                
+                const Key& kox = get_key(tmp->data);
+                size_type n = bucket_num_key(kox);
+                node* first = buckets[n];
+                for(node* cur = first; cur; cur = cur->next) {
+                    // instead of inserting right here
+                    // which is also a valid way (and easier)
+                    // we find the first element that is equal to x
+                    // to maintain the stable ordering
+                    // plus this can make other functions easier (erase, equal_range, etc.)
+                    if(equals(get_key(cur->data), kox)) { 
+                        tmp->next = cur->next;
+                        cur->next = tmp;
+                        ++num_elements;
+                        return iterator(tmp, this);
+                    }
+                }
+                tmp->next = first;
+                buckets[n] = tmp;
+                ++num_elements;
+                return iterator(tmp, this);
+            }
+
+            template <typename... Args>
+            node* create_node(node_source* batch, Args&&... args) {
+                node* res = batch ? batch->get() : node_allocator::allocate(1);
+                ZJ_construct(&(res->data), std::forward<Args>(args)...);
                 return res;
             }
 
             void delete_node(node* ptr) {
                 ZJ_destroy(iterator(ptr, this));
-                node_allocator::deallocate(ptr, sizeof(node));
+                node_allocator::deallocate(ptr, 1);
             }
 
             void initialize_buckets(size_type n) {
@@ -509,7 +634,7 @@ namespace ZJ {
             void resize(size_type num) {
                 if(num > bucket_size()) {
                     size_type new_bucket_size = next_prime(num);
-                    vector<node*> new_buckets(new_bucket_size, (node*)0);
+                    vector<node*, bucket_allocator> new_buckets(new_bucket_size, (node*)0, buckets.get_allocator());
                     for(size_type i = 0; i < bucket_size(); ++i) {
                         node* first = buckets[i];
                         while(first) {
@@ -0,0 +1,142 @@
+
+
+
+#ifndef _ZJ_HUGEPAGE_
+#define _ZJ_HUGEPAGE_
+
+#include <cstddef>
+#include <cstring>
+#include "ZJ_alloc.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace ZJ {
+
+    // huge page aware malloc
+    /**
+     * Blocks of at least __THRESHOLD bytes are mapped directly with mmap,
+     * aligned to a 2 MB boundary, rounded up to whole huge pages and marked
+     * with madvise(MADV_HUGEPAGE), so transparent huge pages back them and a
+     * random access into a big bucket array or vector costs far fewer TLB misses.
+     * Smaller blocks keep the normal path (Alloc: malloc or memory pool).
+     * reallocate() between huge sizes goes through mremap: the block grows in
+     * place or its pages are moved to a new range, the bytes are never copied.
+     * Without MADV_HUGEPAGE (non-Linux) everything goes to Alloc.
+     *
+     * Use it through the allocator wrapper:
+     *      vector<int, allocator<int, __allocator_hugepage>> v;
+     *      unordered_set<int, hash<int>, equal<int>, hugepage_allocator<int>> s;
+    */
+    class __allocator_hugepage {
+
+        public :
+            enum {__HUGE_PAGE_SIZE = 2 * 1024 * 1024};
+            enum {__THRESHOLD = __HUGE_PAGE_SIZE}; // nothing to gain below one huge page
+
+        private :
+            static size_t round_up(size_t bytes) {
+                return (bytes + __HUGE_PAGE_SIZE - 1) & ~((size_t)__HUGE_PAGE_SIZE - 1);
+            }
+
+            static bool is_huge(size_t n) {
+            #ifdef MADV_HUGEPAGE
+                return n >= (size_t)__THRESHOLD;
+            #else
+                return false;
+            #endif
+            }
+
+        public :
+            static void* allocate(size_t n) {
+                if(!is_huge(n)) return Alloc::allocate(n);
+                return map_huge(round_up(n));
+            }
+
+            static void deallocate(void* p, size_t n) {
+                if(p == 0) return ;
+                if(!is_huge(n)) {
+                    Alloc::deallocate(p, n);
+                    return ;
+                }
+                unmap_huge(p, round_up(n));
+            }
+
+            static void* reallocate(void* p, size_t old_sz, size_t new_sz) {
+                if(!is_huge(old_sz) && !is_huge(new_sz)) return Alloc::reallocate(p, old_sz, new_sz);
+                if(p != 0 && is_huge(old_sz) && is_huge(new_sz)) {
+                    if(round_up(old_sz) == round_up(new_sz)) return p;
+                    return remap_huge(p, round_up(old_sz), round_up(new_sz));
+                }
+                void* res = allocate(new_sz);
+                if(p != 0) {
+                    memcpy(res, p, old_sz < new_sz ? old_sz : new_sz);
+                    deallocate(p, old_sz);
+                }
+                return res;
+            }
+
+        protected :
+        #ifdef MADV_HUGEPAGE
+            // len is a multiple of the huge page size
+            static void* map_huge(size_t len) {
+                // over-map by one huge page, then trim head and tail to get 2 MB alignment
+                size_t map_len = len + __HUGE_PAGE_SIZE;
+                char* raw = (char*)mmap(0, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(raw == (char*)MAP_FAILED) {
+                    cerr << "out of memory (mmap of " << map_len << " bytes failed)" << endl;
+                    exit(1);
+                }
+                char* res = (char*)(((size_t)raw + __HUGE_PAGE_SIZE - 1) & ~((size_t)__HUGE_PAGE_SIZE - 1));
+                size_t head = res - raw;
+                size_t tail = map_len - head - len;
+                if(head) munmap(raw, head);
+                if(tail) munmap(res + len, tail);
+                madvise(res, len, MADV_HUGEPAGE);
+                return res;
+            }
+
+            static void unmap_huge(void* p, size_t len) {
+                munmap(p, len);
+            }
+
+            // old_len and new_len are multiples of the huge page size
+            static void* remap_huge(void* p, size_t old_len, size_t new_len) {
+            #ifdef MREMAP_FIXED
+                // shrink, or grow into the pages right after the block: nothing moves
+                void* res = mremap(p, old_len, new_len, 0);
+                if(res != MAP_FAILED) {
+                    if(new_len > old_len) madvise((char*)res + old_len, new_len - old_len, MADV_HUGEPAGE);
+                    return res;
+                }
+                // move the page table entries onto a fresh 2 MB aligned range,
+                // no byte is copied and the old range is unmapped by mremap
+                char* dst = (char*)map_huge(new_len);
+                res = mremap(p, old_len, new_len, MREMAP_MAYMOVE | MREMAP_FIXED, dst);
+                if(res != MAP_FAILED) {
+                    madvise(dst, new_len, MADV_HUGEPAGE);
+                    return res;
+                }
+                unmap_huge(dst, new_len);
+            #endif
+                void* copy = map_huge(new_len);
+                memcpy(copy, p, old_len < new_len ? old_len : new_len);
+                unmap_huge(p, old_len);
+                return copy;
+            }
+        #else
+            static void* map_huge(size_t len) {return Alloc::allocate(len);}
+
+            static void unmap_huge(void* p, size_t len) {Alloc::deallocate(p, len);}
+
+            static void* remap_huge(void* p, size_t old_len, size_t new_len) {return Alloc::reallocate(p, old_len, new_len);}
+        #endif
+    };
+
+    template <typename T>
+    using hugepage_allocator = allocator<T, __allocator_hugepage>;
+
+}
+
+#endif
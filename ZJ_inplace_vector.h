@@ -0,0 +1,347 @@
+
+
+
+#ifndef _ZJ_INPLACE_VECTOR_
+#define _ZJ_INPLACE_VECTOR_
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <initializer_list>
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+
+namespace ZJ {
+
+    /**
+     * Element storage of inplace_vector, it owns the elements [0, count).
+     * Trivial types are kept in a plain T[N], so the whole inplace_vector is
+     * a literal type and can be built and read in constant expressions;
+     * construct / destroy / relocate are assignments and loops there.
+     * Other types live in raw bytes and go through ZJ_construct / ZJ_relocate.
+    */
+    template <typename T, size_t N, bool Trivial>
+    struct __inplace_storage;
+
+    template <typename T, size_t N>
+    struct __inplace_storage<T, N, true> {
+        T elems[N];
+        size_t count;
+
+        ZJ_CONSTEXPR14 __inplace_storage() : elems(), count(0) {}
+
+        ZJ_CONSTEXPR14 T* ptr() {return elems;}
+
+        ZJ_CONSTEXPR14 const T* ptr() const {return elems;}
+
+        template <typename... Args>
+        ZJ_CONSTEXPR14 void construct(size_t i, Args&&... args) {elems[i] = T(std::forward<Args>(args)...);}
+
+        ZJ_CONSTEXPR14 void destroy(size_t, size_t) {}
+
+        // [first, last) -> [dest, dest + last - first), overlapping like memmove
+        ZJ_CONSTEXPR14 void relocate(size_t first, size_t last, size_t dest) {
+            if(dest < first) {
+                for(; first != last; ++first, ++dest) elems[dest] = elems[first];
+            }
+            else {
+                dest += last - first;
+                while(last != first) elems[--dest] = elems[--last];
+            }
+        }
+    };
+
+    template <typename T, size_t N>
+    struct __inplace_storage<T, N, false> {
+        alignas(T) unsigned char bytes[N * sizeof(T)];
+        size_t count;
+
+        __inplace_storage() : count(0) {}
+
+        __inplace_storage(const __inplace_storage& s) : count(0) {
+            ZJ_uninitialized_copy(s.ptr(), s.ptr() + s.count, ptr());
+            count = s.count;
+        }
+
+        // s keeps its elements, moved from
+        __inplace_storage(__inplace_storage&& s) : count(0) {
+            ZJ_uninitialized_move(s.ptr(), s.ptr() + s.count, ptr());
+            count = s.count;
+        }
+
+        ~__inplace_storage() {destroy(0, count);}
+
+        __inplace_storage& operator= (const __inplace_storage& s) {
+            if(this != &s) {
+                destroy(0, count);
+                count = 0;
+                ZJ_uninitialized_copy(s.ptr(), s.ptr() + s.count, ptr());
+                count = s.count;
+            }
+            return *this;
+        }
+
+        __inplace_storage& operator= (__inplace_storage&& s) {
+            if(this != &s) {
+                destroy(0, count);
+                count = 0;
+                ZJ_uninitialized_move(s.ptr(), s.ptr() + s.count, ptr());
+                count = s.count;
+            }
+            return *this;
+        }
+
+        T* ptr() {return (T*)bytes;}
+
+        const T* ptr() const {return (const T*)bytes;}
+
+        template <typename... Args>
+        void construct(size_t i, Args&&... args) {ZJ_construct(ptr() + i, std::forward<Args>(args)...);}
+
+        void destroy(size_t first, size_t last) {ZJ_destroy(ptr() + first, ptr() + last);}
+
+        void relocate(size_t first, size_t last, size_t dest) {
+            if(dest < first) ZJ_relocate(ptr() + first, ptr() + last, ptr() + dest);
+            else ZJ_relocate_backward(ptr() + first, ptr() + last, ptr() + dest + (last - first));
+        }
+    };
+
+    /**
+     * vector with a fixed capacity of N elements stored inside the object,
+     * it never touches the heap. Same interface as vector, with raw pointers
+     * as iterators; going past N prints an error and exits, like running out
+     * of memory does. try_push_back / try_emplace_back return 0 instead.
+     * With C++14 and a trivial T, most of it is constexpr:
+     *
+     *      ZJ_CONSTEXPR14 inplace_vector<int, 16> squares() {
+     *          inplace_vector<int, 16> v;
+     *          for(int i = 0; i < 16; ++i) v.push_back(i * i);
+     *          return v;
+     *      }
+     *      constexpr inplace_vector<int, 16> table = squares();
+     *
+     *      inplace_vector<size_t, 16> candidates;              // scratch list, no allocation
+    */
+    template <typename T, size_t N>
+    class inplace_vector : protected __inplace_storage<T, N, std::is_trivial<T>::value> {
+        static_assert(N > 0, "inplace_vector needs room for at least one element");
+
+        protected :
+            typedef __inplace_storage<T, N, std::is_trivial<T>::value> storage;
+
+        public :
+            typedef T                   value_type;
+            typedef T*                  pointer;
+            typedef const T*            const_pointer;
+            typedef T*                  iterator;
+            typedef const T*            const_iterator;
+            typedef T&                  reference;
+            typedef const T&            const_reference;
+            typedef size_t              size_type;
+            typedef ptrdiff_t           difference_type;
+
+        public :
+            ZJ_CONSTEXPR14 inplace_vector() : storage() {}
+
+            ZJ_CONSTEXPR14 explicit inplace_vector(size_type n) : storage() {insert(end(), n, T());}
+
+            ZJ_CONSTEXPR14 inplace_vector(size_type n, const T& value) : storage() {insert(end(), n, value);}
+
+            ZJ_CONSTEXPR14 inplace_vector(const_iterator first, const_iterator last) : storage() {append(first, last);}
+
+            ZJ_CONSTEXPR14 inplace_vector(std::initializer_list<T> il) : storage() {append(il.begin(), il.end());}
+
+            ZJ_CONSTEXPR14 iterator begin() {return this->ptr();}
+
+            ZJ_CONSTEXPR14 const_iterator begin() const {return this->ptr();}
+
+            ZJ_CONSTEXPR14 const_iterator cbegin() const {return this->ptr();}
+
+            ZJ_CONSTEXPR14 iterator end() {return this->ptr() + this->count;}
+
+            ZJ_CONSTEXPR14 const_iterator end() const {return this->ptr() + this->count;}
+
+            ZJ_CONSTEXPR14 const_iterator cend() const {return this->ptr() + this->count;}
+
+            ZJ_CONSTEXPR14 reference front() {return *begin();}
+
+            ZJ_CONSTEXPR14 const_reference front() const {return *begin();}
+
+            ZJ_CONSTEXPR14 reference back() {return *(end() - 1);}
+
+            ZJ_CONSTEXPR14 const_reference back() const {return *(end() - 1);}
+
+            ZJ_CONSTEXPR14 size_type size() const {return this->count;}
+
+            static ZJ_CONSTEXPR14 size_type capacity() {return N;}
+
+            ZJ_CONSTEXPR14 bool empty() const {return this->count == 0;}
+
+            ZJ_CONSTEXPR14 bool full() const {return this->count == N;}
+
+            ZJ_CONSTEXPR14 reference operator[] (size_type idx) {return this->ptr()[idx];}
+
+            ZJ_CONSTEXPR14 const_reference operator[] (size_type idx) const {return this->ptr()[idx];}
+
+            ZJ_CONSTEXPR14 pointer data() {return this->ptr();}
+
+            ZJ_CONSTEXPR14 const_pointer data() const {return this->ptr();}
+
+            // nothing to allocate, only checks new_cap against N
+            ZJ_CONSTEXPR14 void reserve(size_type new_cap) {
+                if(new_cap > N) overflow();
+            }
+
+            ZJ_CONSTEXPR14 void shrink_to_fit() {}
+
+            ZJ_CONSTEXPR14 void push_back(const value_type& value) {
+                emplace_back(value);
+            }
+
+            ZJ_CONSTEXPR14 void push_back(value_type&& value) {
+                emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            ZJ_CONSTEXPR14 void emplace_back(Args&&... args) {
+                check_room(1);
+                this->construct(this->count, std::forward<Args>(args)...);
+                ++this->count;
+            }
+
+            // 0 when full, a pointer to the new element otherwise
+            template <typename... Args>
+            ZJ_CONSTEXPR14 pointer try_emplace_back(Args&&... args) {
+                if(full()) return 0;
+                this->construct(this->count, std::forward<Args>(args)...);
+                return this->ptr() + this->count++;
+            }
+
+            ZJ_CONSTEXPR14 pointer try_push_back(const value_type& value) {
+                return try_emplace_back(value);
+            }
+
+            ZJ_CONSTEXPR14 pointer try_push_back(value_type&& value) {
+                return try_emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            ZJ_CONSTEXPR14 iterator emplace(iterator pos, Args&&... args) {
+                size_type index = pos - begin();
+                check_room(1);
+                if(index == this->count) this->construct(index, std::forward<Args>(args)...);
+                else {
+                    // args may refer to an element that is about to be moved
+                    T tmp(std::forward<Args>(args)...);
+                    this->relocate(index, this->count, index + 1);
+                    this->construct(index, std::move(tmp));
+                }
+                ++this->count;
+                return begin() + index;
+            }
+
+            ZJ_CONSTEXPR14 void pop_back() {
+                --this->count;
+                this->destroy(this->count, this->count + 1);
+            }
+
+            ZJ_CONSTEXPR14 iterator insert(iterator pos, const T& value) {
+                return emplace(pos, value);
+            }
+
+            ZJ_CONSTEXPR14 iterator insert(iterator pos, T&& value) {
+                return emplace(pos, std::move(value));
+            }
+
+            ZJ_CONSTEXPR14 void insert(iterator pos, size_type n, const T& value) {
+                if(n == 0) return ;
+                size_type index = pos - begin();
+                check_room(n);
+                T tmp(value); // value may be an element of this vector
+                this->relocate(index, this->count, index + n);
+                for(size_type i = index; i < index + n; ++i) this->construct(i, tmp);
+                this->count += n;
+            }
+
+            // the range is appended and rotated into place, elements never move while
+            // appending, so [first, last) may be part of this vector or an input stream
+            template <typename InputIterator>
+            ZJ_CONSTEXPR14 void insert(iterator pos, InputIterator first, InputIterator last) {
+                insert_dispatch(pos, first, last, typename bool_tag<std::is_integral<InputIterator>::value>::type());
+            }
+
+            // insert(end(), first, last)
+            template <typename InputIterator>
+            ZJ_CONSTEXPR14 void append(InputIterator first, InputIterator last) {
+                insert(end(), first, last);
+            }
+
+            ZJ_CONSTEXPR14 iterator erase(iterator pos) {
+                return erase(pos, pos + 1);
+            }
+
+            ZJ_CONSTEXPR14 iterator erase(iterator first, iterator last) {
+                size_type i = first - begin(), j = last - begin();
+                if(i == j) return first;
+                this->destroy(i, j);
+                this->relocate(j, this->count, i);
+                this->count -= j - i;
+                return begin() + i;
+            }
+
+            ZJ_CONSTEXPR14 void clear() {
+                this->destroy(0, this->count);
+                this->count = 0;
+            }
+
+            ZJ_CONSTEXPR14 void swap(inplace_vector& rhs) {
+                inplace_vector tmp(std::move(rhs));
+                rhs = std::move(*this);
+                *this = std::move(tmp);
+            }
+
+        protected :
+            ZJ_CONSTEXPR14 void check_room(size_type n) const {
+                if(n > N - this->count) overflow();
+            }
+
+            static void overflow() {
+                std::cerr << "inplace_vector: capacity of " << N << " elements exceeded" << std::endl;
+                exit(1);
+            }
+
+            // insert(pos, 3, 5) with ints lands in the template, it means 3 copies of 5
+            template <typename Integer>
+            ZJ_CONSTEXPR14 void insert_dispatch(iterator pos, Integer n, Integer value, TRUE_TAG) {
+                insert(pos, (size_type)n, (value_type)value);
+            }
+
+            template <typename InputIterator>
+            ZJ_CONSTEXPR14 void insert_dispatch(iterator pos, InputIterator first, InputIterator last, FALSE_TAG) {
+                size_type index = pos - begin();
+                size_type old_count = this->count;
+                for(; first != last; ++first) emplace_back(*first);
+                rotate(index, old_count, this->count);
+            }
+
+            // [first, mid) [mid, last) -> [mid, last) [first, mid)
+            ZJ_CONSTEXPR14 void rotate(size_type first, size_type mid, size_type last) {
+                if(first == mid || mid == last) return ;
+                reverse(first, mid);
+                reverse(mid, last);
+                reverse(first, last);
+            }
+
+            ZJ_CONSTEXPR14 void reverse(size_type first, size_type last) {
+                T* p = this->ptr();
+                for(; first + 1 < last; ++first, --last) {
+                    T tmp(std::move(p[first]));
+                    p[first] = std::move(p[last - 1]);
+                    p[last - 1] = std::move(tmp);
+                }
+            }
+    };
+
+}
+
+#endif
@@ -3,6 +3,8 @@
 #ifndef _ZJ_ITERATOR_
 #define _ZJ_ITERATOR_
 
+#include <cstddef>
+
 namespace ZJ {
 
     template    <typename Category,
@@ -24,6 +26,34 @@ namespace ZJ {
     struct bidirectional_iterator_tag : public forward_iterator_tag { };
     struct random_access_iterator_tag : public bidirectional_iterator_tag { };
 
+    // the types an algorithm needs from an iterator, raw pointers included
+    template <typename Iter>
+    struct iterator_traits {
+        typedef typename Iter::iterator_category    iterator_category;
+        typedef typename Iter::value_type           value_type;
+        typedef typename Iter::difference_type      difference_type;
+        typedef typename Iter::pointer              pointer;
+        typedef typename Iter::reference            reference;
+    };
+
+    template <typename T>
+    struct iterator_traits<T*> {
+        typedef random_access_iterator_tag  iterator_category;
+        typedef T                           value_type;
+        typedef ptrdiff_t                   difference_type;
+        typedef T*                          pointer;
+        typedef T&                          reference;
+    };
+
+    template <typename T>
+    struct iterator_traits<const T*> {
+        typedef random_access_iterator_tag  iterator_category;
+        typedef T                           value_type;
+        typedef ptrdiff_t                   difference_type;
+        typedef const T*                    pointer;
+        typedef const T&                    reference;
+    };
+
     /**
      * The following virtual classes will not be used.
      * They only serve as a template in the actual iterator design.
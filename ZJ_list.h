@@ -100,10 +100,11 @@ namespace ZJ {
             }
     };
 
-    template <typename T, typename Alloc = ZJ::allocator<list_node<T>>>
-    class list {
+    template <typename T, typename Alloc = ZJ::allocator<T>>
+    class list : protected alloc_rebind<Alloc, list_node<T>>::other {
         public : 
             typedef T                                       value_type;
+            typedef Alloc                                   allocator_type;
             typedef T*                                      pointer;
             typedef list_node<T>*                           node_pointer;
             typedef list_iterator<T, T*, T&>                iterator;
@@ -113,7 +114,10 @@ namespace ZJ {
             typedef ptrdiff_t                               difference_type;
 
         protected : 
-            typedef Alloc list_allocator;
+            typedef typename alloc_rebind<Alloc, list_node<T>>::other list_allocator;
+            typedef typename tag_and<typename alloc_traits<list_allocator>::IS_MONOTONIC, 
+                                     typename traits<T>::HAS_TRIVIAL_DESTRUCTOR>::type skip_nodes_tag;
+            typedef node_batch<list_allocator> node_source;
             node_pointer node;
         
         //friend class list_iterator<T, T*, T&>;
@@ -121,22 +125,52 @@ namespace ZJ {
         
         public : 
             list() {
-                node = new list_node<T>();
+                empty_initialize();
             }
 
-            list(const_iterator first, const_iterator last) {
-                node = new list_node<T>();
-                for(; first != last; ++first)
-                    insert(end(), *first);
+            explicit list(const Alloc& a) : list_allocator(a) {
+                empty_initialize();
+            }
+
+            list(const_iterator first, const_iterator last, const Alloc& a = Alloc()) : list_allocator(a) {
+                empty_initialize();
+                insert(end(), first, last);
+            }
+
+            list(const list& lst) : list_allocator(lst) {
+                empty_initialize();
+                insert(end(), lst.begin(), lst.end());
+            }
+
+            // takes lst's nodes and sentinel, lst is left on the shared sentinel
+            list(list&& lst) : list_allocator(lst), node(lst.node) {
+                lst.node = shared_sentinel();
+            }
+
+            ~list() {
+                clear();
+                if(node != shared_sentinel())
+                    list_allocator::deallocate(node, 1);
+            }
+
+            list& operator= (const list& rhs) {
+                if(this != &rhs) {
+                    list tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
             }
 
-            list(const list<T>& lst) {
-                node = new list_node<T>();
-                for(const_iterator it = lst.begin(); it != lst.end(); ++it) {
-                    insert(end(), *it);
+            list& operator= (list&& rhs) {
+                if(this != &rhs) {
+                    clear();
+                    swap(rhs);
                 }
+                return *this;
             }
 
+            allocator_type get_allocator() const {return allocator_type(*static_cast<const list_allocator*>(this));}
+
             iterator begin() {
                 return iterator((*node).next);
             }
@@ -179,13 +213,29 @@ namespace ZJ {
             reference back() {return *(--end());}
 
             iterator insert(iterator pos, const T& value) {
-                node_pointer tmp = pos->prev;
-                node_pointer new_node = create_node(value); 
-                tmp->next = new_node;
-                new_node->next = pos.get_raw_pointer();
-                pos->prev = new_node;
-                new_node->prev = tmp;
-                return new_node;
+                pos = own_sentinel(pos);
+                return link_node(pos, create_node(0, value));
+            }
+
+            iterator insert(iterator pos, T&& value) {
+                pos = own_sentinel(pos);
+                return link_node(pos, create_node(0, std::move(value)));
+            }
+
+            template <typename... Args>
+            iterator emplace(iterator pos, Args&&... args) {
+                pos = own_sentinel(pos);
+                return link_node(pos, create_node(0, std::forward<Args>(args)...));
+            }
+
+            // nodes for a range come in batches when the allocator has a bulk allocate_n, see node_batch
+            template <typename InputIterator>
+            void insert(iterator pos, InputIterator first, InputIterator last) {
+                if(first == last) return ;
+                pos = own_sentinel(pos);
+                node_source batch(*this);
+                for(; first != last; ++first)
+                    link_node(pos, create_node(&batch, *first));
             }
 
             iterator erase(iterator pos) {
@@ -203,10 +253,28 @@ namespace ZJ {
                 insert(end(), value);
             }
 
+            void push_back(T&& value) {
+                insert(end(), std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_back(Args&&... args) {
+                emplace(end(), std::forward<Args>(args)...);
+            }
+
             void push_front(const T& value) {
                 insert(begin(), value);
             }
 
+            void push_front(T&& value) {
+                insert(begin(), std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_front(Args&&... args) {
+                emplace(begin(), std::forward<Args>(args)...);
+            }
+
             iterator pop_back() {
                 return erase(--end());
             }
@@ -216,8 +284,7 @@ namespace ZJ {
             }
 
             void clear() {
-                while(!empty()) 
-                    erase(begin());
+                if(!empty()) clear_nodes(skip_nodes_tag());
             }
 
             void remove(const T& value) {
@@ -264,7 +331,7 @@ namespace ZJ {
                 transfer(pos, first, last);
             }
 
-            void merge(list<T, Alloc>& lst) {
+            void merge(list& lst) {
                 iterator it1 = begin(), it2 = lst.begin();
                 while(it1 != end() && it2 != lst.end()) {
                     if(*it1 <= *it2) ++it1;
@@ -291,23 +358,76 @@ namespace ZJ {
 
             void sort() {} // a bad design to have a sort in list
 
-            void swap(list<T>& lst) {
+            void swap(list& lst) {
+                ZJ_swap(static_cast<list_allocator&>(*this), static_cast<list_allocator&>(lst));
                 ZJ_swap(node, lst.node);
             }
 
         protected : 
-            node_pointer create_node(const T& value) {
-                node_pointer ptr =  list_allocator::allocate(1);
-                ZJ_construct(&(ptr->data), value);
+            // the sentinel node holds no value, only its links are set up
+            void empty_initialize() {
+                node = list_allocator::allocate(1);
+                node->prev = node;
+                node->next = node;
+            }
+
+            // sentinel of every moved-from list of this type, never written to:
+            // such a list reads as empty and gets a sentinel of its own on its first insert
+            static node_pointer shared_sentinel() {
+                static typename std::aligned_storage<sizeof(list_node<T>), alignof(list_node<T>)>::type storage;
+                static node_pointer s = init_shared_sentinel((node_pointer)&storage);
+                return s;
+            }
+
+            static node_pointer init_shared_sentinel(node_pointer s) {
+                s->prev = s;
+                s->next = s;
+                return s;
+            }
+
+            // called before anything is linked in at pos, on the shared sentinel pos can only be end()
+            iterator own_sentinel(iterator pos) {
+                if(node->next != node || node != shared_sentinel()) return pos;
+                empty_initialize();
+                return end();
+            }
+
+            template <typename... Args>
+            node_pointer create_node(node_source* batch, Args&&... args) {
+                node_pointer ptr = batch ? batch->get() : list_allocator::allocate(1);
+                ZJ_construct(&(ptr->data), std::forward<Args>(args)...);
                 return ptr;
             }
 
+            // links new_node in before pos
+            iterator link_node(iterator pos, node_pointer new_node) {
+                node_pointer tmp = pos->prev;
+                tmp->next = new_node;
+                new_node->next = pos.get_raw_pointer();
+                pos->prev = new_node;
+                new_node->prev = tmp;
+                return new_node;
+            }
+
+            void clear_nodes(FALSE_TAG) {
+                while(!empty()) 
+                    erase(begin());
+            }
+
+            // monotonic allocator and nothing to destroy: the nodes are simply dropped
+            void clear_nodes(TRUE_TAG) {
+                node->prev = node;
+                node->next = node;
+            }
+
             void destroy_node(iterator it) {
-                ZJ_destroy(it);
-                Alloc::deallocate(it.get_raw_pointer(), sizeof(it.get_raw_pointer()));
+                // it-> gives the node, not the value, so destroy the value directly
+                it.get_raw_pointer()->data.~T();
+                list_allocator::deallocate(it.get_raw_pointer(), 1);
             }
 
             void transfer(iterator pos, iterator first, iterator last) {
+                pos = own_sentinel(pos);
                 iterator first_prev(first->prev);
                 iterator last_prev(last->prev);
                 iterator pos_prev(pos->prev);
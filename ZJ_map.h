@@ -10,13 +10,14 @@
 
 namespace ZJ {
 
-    template <class Key, class Value, class Compare = ZJ::less<Key>>
+    template <class Key, class Value, class Compare = ZJ::less<Key>, class Alloc = allocator<pair<const Key, Value>>>
     class map {
         public : 
             typedef Key                     key_type;
             typedef Value                   data_type;
             typedef Value                   mapped_type;
             typedef pair<const Key, Value>  value_type;
+            typedef Alloc                   allocator_type;
             
             // key_compare: compares the key
             // value_compare here: actually compares first of the pair, which is the key
@@ -31,7 +32,7 @@ namespace ZJ {
 
         private :
             // value_type here is a pair, meaning both key and value are stored, not just value
-            typedef rb_tree<key_type, value_type, select1st<value_type>, Compare> Container;
+            typedef rb_tree<key_type, value_type, select1st<value_type>, Compare, Alloc> Container;
             Container c;
         
         public : 
@@ -46,7 +47,23 @@ namespace ZJ {
 
             map() : c() {}
 
-            map(const map<Key, Value, Compare>& m) : c(m.c) {}
+            explicit map(const Compare& comp, const allocator_type& a = allocator_type()) : c(comp, a) {}
+
+            map(const map& m) : c(m.c) {}
+
+            map(map&& m) : c(std::move(m.c)) {}
+
+            map& operator= (const map& m) {
+                c = m.c;
+                return *this;
+            }
+
+            map& operator= (map&& m) {
+                c = std::move(m.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
 
             key_compare key_comp() const {return c.key_comp();}
 
@@ -80,6 +97,20 @@ namespace ZJ {
                 return c.insert_unique(value);
             }
 
+            pair<iterator, bool> insert(value_type&& value) {
+                return c.insert_unique(std::move(value));
+            }
+
+            template <typename... Args>
+            pair<iterator, bool> emplace(Args&&... args) {
+                return c.emplace_unique(std::forward<Args>(args)...);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(iterator hint, Args&&... args) {
+                return c.emplace_hint_unique(hint, std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_unique(first, last);
             }
@@ -142,13 +173,14 @@ namespace ZJ {
     };
 
 
-    template <class Key, class Value, class Compare = ZJ::less<Key>>
+    template <class Key, class Value, class Compare = ZJ::less<Key>, class Alloc = allocator<pair<const Key, Value>>>
     class multimap {
         public : 
             typedef Key                     key_type;
             typedef Value                   data_type;
             typedef Value                   mapped_type;
             typedef pair<const Key, Value>  value_type;
+            typedef Alloc                   allocator_type;
 
             typedef Compare                 key_compare;
             struct value_compare : public binary_function<value_type, value_type, bool> {
@@ -160,7 +192,7 @@ namespace ZJ {
             };
 
         private :
-            typedef rb_tree<key_type, value_type, select1st<value_type>, Compare> Container;
+            typedef rb_tree<key_type, value_type, select1st<value_type>, Compare, Alloc> Container;
             Container c;
         
         public :
@@ -175,7 +207,23 @@ namespace ZJ {
 
             multimap() : c() {}
 
-            multimap(const multimap<Key, Value, Compare>& mm) : c(mm.c) {}
+            explicit multimap(const Compare& comp, const allocator_type& a = allocator_type()) : c(comp, a) {}
+
+            multimap(const multimap& mm) : c(mm.c) {}
+
+            multimap(multimap&& mm) : c(std::move(mm.c)) {}
+
+            multimap& operator= (const multimap& mm) {
+                c = mm.c;
+                return *this;
+            }
+
+            multimap& operator= (multimap&& mm) {
+                c = std::move(mm.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
 
             key_compare key_comp() const {return c.key_comp();}
 
@@ -212,6 +260,20 @@ namespace ZJ {
                 return c.insert_equal(value);
             }
 
+            iterator insert(value_type&& value) {
+                return c.insert_equal(std::move(value));
+            }
+
+            template <typename... Args>
+            iterator emplace(Args&&... args) {
+                return c.emplace_equal(std::forward<Args>(args)...);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(iterator hint, Args&&... args) {
+                return c.emplace_hint_equal(hint, std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_equal(first, last);
             }
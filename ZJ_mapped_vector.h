@@ -0,0 +1,289 @@
+
+
+
+#ifndef _ZJ_MAPPED_VECTOR_
+#define _ZJ_MAPPED_VECTOR_
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+#include "ZJ_vector.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define __ZJ_HAS_MMAP
+#endif
+
+namespace ZJ {
+
+#ifdef __ZJ_HAS_MMAP
+
+    /**
+     * vector whose elements are the contents of a file, mapped with mmap
+     * (MAP_SHARED): opening a multi-GB file costs no read and no copy, pages
+     * come in from the page cache on first touch, and processes mapping the
+     * same file share those pages. The file is a plain array of T, size() is
+     * its length / sizeof(T); T must be trivially copyable.
+     *
+     * While open for writing the file is extended to capacity() with
+     * ftruncate and grown with mremap (munmap + mmap without it), so growing
+     * never copies through user space; close() cuts it back to size().
+     * Everything written lands in the page cache, flush() forces it to disk.
+     * advise() passes an access pattern to the kernel (madvise).
+     *
+     *      mapped_vector<tick> ticks("ticks.bin");                 // read only
+     *      ticks.advise(mapped_vector<tick>::SEQUENTIAL);
+     *      for(const tick& t : ticks) ...
+     *
+     *      mapped_vector<tick> out("out.bin", mapped_vector<tick>::TRUNCATE);
+     *      out.push_back(t);
+     *
+     * POSIX only. Opening returns false on failure; running out of file or
+     * address space later prints an error and exits, like running out of memory.
+    */
+    template <typename T>
+    class mapped_vector {
+        static_assert(std::is_trivially_copyable<T>::value, "mapped_vector stores T as raw bytes, T must be trivially copyable");
+
+        public :
+            typedef T                           value_type;
+            typedef T*                          pointer;
+            typedef const T*                    const_pointer;
+            typedef vector_iterator<T>          iterator;
+            typedef vector_iterator<const T>    const_iterator;
+            typedef T&                          reference;
+            typedef const T&                    const_reference;
+            typedef size_t                      size_type;
+            typedef ptrdiff_t                   difference_type;
+
+            enum open_mode {
+                READ_ONLY,      // existing file, no writes
+                READ_WRITE,     // existing file or a new empty one, contents kept
+                TRUNCATE        // new empty file, an existing one is emptied
+            };
+
+            enum access_advice {
+                NORMAL = MADV_NORMAL,
+                SEQUENTIAL = MADV_SEQUENTIAL,
+                RANDOM = MADV_RANDOM,
+                WILLNEED = MADV_WILLNEED,   // start reading the pages in now
+                DONTNEED = MADV_DONTNEED    // drop the pages, they are read again from the file
+            };
+
+        protected :
+            T* start;
+            size_type num_elements;
+            size_type cap;
+            int fd;
+            bool writable;
+
+        public :
+            mapped_vector() : start(0), num_elements(0), cap(0), fd(-1), writable(false) {}
+
+            explicit mapped_vector(const char* path, open_mode mode = READ_ONLY) :
+                start(0), num_elements(0), cap(0), fd(-1), writable(false) {
+                open(path, mode);
+            }
+
+            mapped_vector(mapped_vector&& v) :
+                start(v.start), num_elements(v.num_elements), cap(v.cap), fd(v.fd), writable(v.writable) {
+                v.start = 0;
+                v.num_elements = v.cap = 0;
+                v.fd = -1;
+            }
+
+            ~mapped_vector() {close();}
+
+            mapped_vector& operator= (mapped_vector&& rhs) {
+                if(this != &rhs) {
+                    close();
+                    swap(rhs);
+                }
+                return *this;
+            }
+
+            // closes the file that is open, if any; false if path cannot be opened or mapped
+            bool open(const char* path, open_mode mode = READ_ONLY) {
+                close();
+                int flags = mode == READ_ONLY ? O_RDONLY : O_RDWR | O_CREAT;
+                if(mode == TRUNCATE) flags |= O_TRUNC;
+                fd = ::open(path, flags, 0644);
+                if(fd < 0) return false;
+                struct stat st;
+                if(fstat(fd, &st) != 0) {
+                    close();
+                    return false;
+                }
+                writable = mode != READ_ONLY;
+                num_elements = cap = (size_type)st.st_size / sizeof(T);
+                if(cap == 0) return true;
+                void* p = mmap(0, bytes(cap), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+                if(p == MAP_FAILED) {
+                    close();
+                    return false;
+                }
+                start = (T*)p;
+                return true;
+            }
+
+            bool is_open() const {return fd >= 0;}
+
+            // unmaps, and cuts the file back to size() if it was open for writing
+            void close() {
+                if(fd < 0) return ;
+                if(start) munmap(start, bytes(cap));
+                if(writable && cap != num_elements && ftruncate(fd, (off_t)bytes(num_elements)) != 0)
+                    std::cerr << "mapped_vector: cannot truncate the file to " << num_elements << " elements" << std::endl;
+                ::close(fd);
+                start = 0;
+                num_elements = cap = 0;
+                fd = -1;
+                writable = false;
+            }
+
+            // writes the dirty pages of [0, size()) to the file and waits for it
+            void flush() {
+                if(start && writable) msync(start, bytes(num_elements), MS_SYNC);
+            }
+
+            // applies to the whole mapping, pages mapped later by growth get the default
+            void advise(access_advice a) {
+                if(start) madvise(start, bytes(cap), (int)a);
+            }
+
+            iterator begin() {return iterator(start);}
+
+            const_iterator begin() const {return const_iterator(start);}
+
+            const_iterator cbegin() const {return const_iterator(start);}
+
+            iterator end() {return iterator(start + num_elements);}
+
+            const_iterator end() const {return const_iterator(start + num_elements);}
+
+            const_iterator cend() const {return const_iterator(start + num_elements);}
+
+            reference front() {return *start;}
+
+            const_reference front() const {return *start;}
+
+            reference back() {return start[num_elements - 1];}
+
+            const_reference back() const {return start[num_elements - 1];}
+
+            size_type size() const {return num_elements;}
+
+            size_type capacity() const {return cap;}
+
+            bool empty() const {return num_elements == 0;}
+
+            reference operator[] (size_type idx) {return start[idx];}
+
+            const_reference operator[] (size_type idx) const {return start[idx];}
+
+            pointer data() {return start;}
+
+            const_pointer data() const {return start;}
+
+            // extends the file and the mapping
+            void reserve(size_type new_cap) {
+                if(new_cap > cap) remap(new_cap);
+            }
+
+            void shrink_to_fit() {
+                if(cap != num_elements) remap(num_elements);
+            }
+
+            void push_back(const value_type& value) {
+                if(num_elements == cap) {
+                    value_type tmp(value); // value may be an element, the mapping may move
+                    remap(cap ? 2 * cap : page_elements());
+                    start[num_elements++] = tmp;
+                }
+                else start[num_elements++] = value;
+            }
+
+            void pop_back() {--num_elements;}
+
+            // new elements are zero (ftruncate fills the file with zeros) or value
+            void resize(size_type n) {
+                reserve(n);
+                if(n > num_elements) memset((void*)(start + num_elements), 0, bytes(n - num_elements));
+                num_elements = n;
+            }
+
+            void resize(size_type n, const value_type& value) {
+                value_type tmp(value);
+                reserve(n);
+                for(; num_elements < n; ++num_elements) start[num_elements] = tmp;
+                num_elements = n;
+            }
+
+            // keeps the capacity, the file is cut when it is closed
+            void clear() {num_elements = 0;}
+
+            void swap(mapped_vector& rhs) {
+                ZJ_swap(start, rhs.start);
+                ZJ_swap(num_elements, rhs.num_elements);
+                ZJ_swap(cap, rhs.cap);
+                ZJ_swap(fd, rhs.fd);
+                ZJ_swap(writable, rhs.writable);
+            }
+
+        protected :
+            static size_type bytes(size_type n) {return n * sizeof(T);}
+
+            // elements in one page, the first growth of an empty file
+            static size_type page_elements() {
+                size_type n = (size_type)sysconf(_SC_PAGESIZE) / sizeof(T);
+                return n ? n : 1;
+            }
+
+            static void fail(const char* what, size_type n) {
+                std::cerr << "mapped_vector: " << what << " failed for " << n << " elements" << std::endl;
+                exit(1);
+            }
+
+            // file and mapping to new_cap >= size() elements
+            void remap(size_type new_cap) {
+                if(!writable) fail("growing a read only or closed file", new_cap);
+                if(new_cap > cap && ftruncate(fd, (off_t)bytes(new_cap)) != 0) fail("ftruncate", new_cap);
+                void* p = MAP_FAILED;
+                if(new_cap == 0) {
+                    if(start) munmap(start, bytes(cap));
+                    p = 0;
+                }
+                else if(start == 0) p = mmap(0, bytes(new_cap), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                else {
+                #ifdef MREMAP_MAYMOVE
+                    // the page table entries move, the data is never copied
+                    p = mremap(start, bytes(cap), bytes(new_cap), MREMAP_MAYMOVE);
+                #else
+                    munmap(start, bytes(cap));
+                    p = mmap(0, bytes(new_cap), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                #endif
+                }
+                if(p == MAP_FAILED) fail("mapping", new_cap);
+                if(new_cap < cap && ftruncate(fd, (off_t)bytes(new_cap)) != 0) fail("ftruncate", new_cap);
+                start = (T*)p;
+                cap = new_cap;
+            }
+
+        private :
+            // one mapping per file descriptor
+            mapped_vector(const mapped_vector&);
+            mapped_vector& operator= (const mapped_vector&);
+    };
+
+#endif
+
+}
+
+#endif
@@ -4,6 +4,9 @@
 #ifndef _ZJ_PAIR_
 #define _ZJ_PAIR_
 
+#include <utility>
+#include <type_traits>
+
 namespace ZJ {
     template <class T1, class T2>
     struct pair {
@@ -16,6 +19,19 @@ namespace ZJ {
         pair() : first(), second() {}
 
         pair(const T1& t1, const T2& t2) : first(t1), second(t2) {}
+
+        // the converting constructors only take part when both members can be built from the arguments
+        template <class U1, class U2, class = typename std::enable_if<std::is_constructible<T1, U1&&>::value && 
+                                                                      std::is_constructible<T2, U2&&>::value>::type>
+        pair(U1&& u1, U2&& u2) : first(std::forward<U1>(u1)), second(std::forward<U2>(u2)) {}
+
+        template <class U1, class U2, class = typename std::enable_if<std::is_constructible<T1, const U1&>::value && 
+                                                                      std::is_constructible<T2, const U2&>::value>::type>
+        pair(const pair<U1, U2>& p) : first(p.first), second(p.second) {}
+
+        template <class U1, class U2, class = typename std::enable_if<std::is_constructible<T1, U1&&>::value && 
+                                                                      std::is_constructible<T2, U2&&>::value>::type>
+        pair(pair<U1, U2>&& p) : first(std::forward<U1>(p.first)), second(std::forward<U2>(p.second)) {}
     };
 }
 
@@ -0,0 +1,539 @@
+
+
+
+#ifndef _ZJ_PERSISTENT_VECTOR_
+#define _ZJ_PERSISTENT_VECTOR_
+
+#include <cstddef>
+#include <atomic>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+
+namespace ZJ {
+
+    /**
+     * Nodes of the persistent_vector trie. Every node is shared by all the
+     * versions that reach it and freed by the last one, so the reference
+     * count is atomic: versions may be read and dropped on different threads.
+     * A node with a count of 1 is reachable only through its one parent and
+     * may be written in place, that is how transients avoid copies.
+    */
+    struct __pvec_node {
+        std::atomic<size_t> refs;
+
+        __pvec_node() : refs(1) {}
+    };
+
+    struct __pvec_inner : __pvec_node {
+        enum {WIDTH = 32};
+
+        __pvec_node* children[WIDTH];
+
+        __pvec_inner() {
+            for(size_t i = 0; i < (size_t)WIDTH; ++i) children[i] = 0;
+        }
+    };
+
+    // elements [0, count) are constructed; a leaf in the trie is always full
+    template <typename T>
+    struct __pvec_leaf : __pvec_node {
+        enum {WIDTH = 32};
+
+        size_t count;
+        alignas(T) unsigned char bytes[WIDTH * sizeof(T)];
+
+        __pvec_leaf() : count(0) {}
+
+        T* elems() {return (T*)bytes;}
+
+        const T* elems() const {return (const T*)bytes;}
+    };
+
+    template <typename T, typename Vec>
+    class persistent_vector_iterator : public iterator_base<random_access_iterator_tag, T> {
+        public :
+            typedef persistent_vector_iterator<T, Vec>  self;
+            typedef const T*                            pointer;
+            typedef const T&                            reference;
+            typedef size_t                              size_type;
+            typedef ptrdiff_t                           difference_type;
+
+            const Vec* vec;
+            size_type index;
+            // elements of the leaf holding index, 0 past the end
+            const T* block;
+
+            persistent_vector_iterator() : vec(0), index(0), block(0) {}
+
+            persistent_vector_iterator(const Vec* v, size_type i) : vec(v) {set_index(i);}
+
+            reference operator* () const {return block[index & Vec::MASK];}
+
+            pointer operator-> () const {return block + (index & Vec::MASK);}
+
+            reference operator[] (difference_type n) const {return *(*this + n);}
+
+            self& operator++ () {
+                if((++index & Vec::MASK) == 0) set_index(index);
+                return *this;
+            }
+
+            self& operator-- () {
+                if(block == 0 || (index & Vec::MASK) == 0) set_index(index - 1);
+                else --index;
+                return *this;
+            }
+
+            self operator++ (int) {
+                self res(*this);
+                ++*this;
+                return res;
+            }
+
+            self operator-- (int) {
+                self res(*this);
+                --*this;
+                return res;
+            }
+
+            self& operator+= (difference_type n) {
+                set_index(index + n);
+                return *this;
+            }
+
+            self& operator-= (difference_type n) {
+                set_index(index - n);
+                return *this;
+            }
+
+            self operator+ (difference_type n) const {return self(vec, index + n);}
+
+            self operator- (difference_type n) const {return self(vec, index - n);}
+
+            difference_type operator- (const self& rhs) const {return (difference_type)index - (difference_type)rhs.index;}
+
+            bool operator== (const self& rhs) const {return index == rhs.index;}
+
+            bool operator!= (const self& rhs) const {return index != rhs.index;}
+
+            bool operator< (const self& rhs) const {return index < rhs.index;}
+
+        protected :
+            void set_index(size_type i) {
+                index = i;
+                block = i < vec->size() ? vec->leaf_for(i)->elems() : 0;
+            }
+    };
+
+    /**
+     * Trie shared by persistent_vector and transient_vector: a 32-way tree of
+     * full leaves plus a tail leaf holding the last 1 - 32 elements, so most
+     * push_back / pop_back only touch the tail. Element i of the tree is at
+     * child (i >> shift) & 31 of the root, then (i >> (shift - 5)) & 31 ...
+     * Writes copy a node only when it is shared (refs > 1) and write it in
+     * place otherwise, so the same code gives path copying for new versions
+     * and in-place updates for a transient that owns its nodes.
+    */
+    template <typename T, typename Alloc>
+    class __pvec_base : protected alloc_rebind<Alloc, __pvec_leaf<T>>::other {
+        template <typename, typename> friend class persistent_vector_iterator;
+
+        public :
+            typedef T                   value_type;
+            typedef Alloc               allocator_type;
+            typedef const T&            const_reference;
+            typedef size_t              size_type;
+            typedef ptrdiff_t           difference_type;
+
+            enum {BITS = 5, WIDTH = 1 << BITS, MASK = WIDTH - 1};
+
+        protected :
+            typedef __pvec_node                                             node;
+            typedef __pvec_inner                                            inner;
+            typedef __pvec_leaf<T>                                          leaf;
+            typedef typename alloc_rebind<Alloc, leaf>::other               leaf_allocator;
+            typedef typename alloc_rebind<Alloc, inner>::other              inner_allocator;
+
+            node* root;         // 0 while the tail holds everything
+            leaf* tail;         // 0 when empty
+            size_type cnt;
+            size_type shift;    // BITS * depth of the tree below root
+
+        public :
+            size_type size() const {return cnt;}
+
+            bool empty() const {return cnt == 0;}
+
+            const_reference operator[] (size_type idx) const {return leaf_for(idx)->elems()[idx & MASK];}
+
+            const_reference front() const {return (*this)[0];}
+
+            const_reference back() const {return tail->elems()[tail->count - 1];}
+
+            allocator_type get_allocator() const {return allocator_type(*static_cast<const leaf_allocator*>(this));}
+
+        protected :
+            __pvec_base() : root(0), tail(0), cnt(0), shift(BITS) {}
+
+            explicit __pvec_base(const Alloc& a) : leaf_allocator(a), root(0), tail(0), cnt(0), shift(BITS) {}
+
+            // shares all of v's nodes
+            __pvec_base(const __pvec_base& v) : leaf_allocator(v), root(v.root), tail(v.tail), cnt(v.cnt), shift(v.shift) {
+                acquire(root);
+                acquire(tail);
+            }
+
+            __pvec_base(__pvec_base&& v) : leaf_allocator(v), root(v.root), tail(v.tail), cnt(v.cnt), shift(v.shift) {
+                v.root = 0;
+                v.tail = 0;
+                v.cnt = 0;
+                v.shift = BITS;
+            }
+
+            ~__pvec_base() {
+                release(root, shift);
+                release(tail, 0);
+            }
+
+            void swap_base(__pvec_base& rhs) {
+                ZJ_swap(static_cast<leaf_allocator&>(*this), static_cast<leaf_allocator&>(rhs));
+                ZJ_swap(root, rhs.root);
+                ZJ_swap(tail, rhs.tail);
+                ZJ_swap(cnt, rhs.cnt);
+                ZJ_swap(shift, rhs.shift);
+            }
+
+            // index of the first element in the tail
+            size_type tail_offset() const {return cnt < (size_type)WIDTH ? 0 : ((cnt - 1) >> BITS) << BITS;}
+
+            const leaf* leaf_for(size_type idx) const {
+                if(idx >= tail_offset()) return tail;
+                const node* n = root;
+                for(size_type level = shift; level > 0; level -= BITS)
+                    n = static_cast<const inner*>(n)->children[(idx >> level) & MASK];
+                return static_cast<const leaf*>(n);
+            }
+
+            static void acquire(node* n) {
+                if(n) n->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // drops one reference to n, a node at level (0 for leaves)
+            void release(node* n, size_type level) {
+                if(n == 0 || n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return ;
+                if(level == 0) {
+                    leaf* l = static_cast<leaf*>(n);
+                    ZJ_destroy(l->elems(), l->elems() + l->count);
+                    ZJ_destroy(l);
+                    leaf_allocator::deallocate(l, 1);
+                    return ;
+                }
+                inner* p = static_cast<inner*>(n);
+                for(size_type i = 0; i < (size_type)WIDTH; ++i) release(p->children[i], level - BITS);
+                ZJ_destroy(p);
+                inner_allocator(*static_cast<leaf_allocator*>(this)).deallocate(p, 1);
+            }
+
+            leaf* new_leaf() {
+                leaf* res = leaf_allocator::allocate(1);
+                ZJ_construct(res);
+                return res;
+            }
+
+            inner* new_inner() {
+                inner* res = inner_allocator(*static_cast<leaf_allocator*>(this)).allocate(1);
+                ZJ_construct(res);
+                return res;
+            }
+
+            // takes our reference to l, returns a leaf only we reach with the same elements
+            leaf* unique_leaf(leaf* l) {
+                if(l->refs.load(std::memory_order_acquire) == 1) return l;
+                leaf* res = new_leaf();
+                ZJ_uninitialized_copy(l->elems(), l->elems() + l->count, res->elems());
+                res->count = l->count;
+                release(l, 0);
+                return res;
+            }
+
+            // same for an inner node at level, 0 gives a new empty node
+            inner* unique_inner(node* n, size_type level) {
+                if(n == 0) return new_inner();
+                if(n->refs.load(std::memory_order_acquire) == 1) return static_cast<inner*>(n);
+                inner* p = static_cast<inner*>(n);
+                inner* res = new_inner();
+                for(size_type i = 0; i < (size_type)WIDTH; ++i) {
+                    res->children[i] = p->children[i];
+                    acquire(res->children[i]);
+                }
+                release(p, level);
+                return res;
+            }
+
+            template <typename... Args>
+            void do_emplace_back(Args&&... args) {
+                if(tail != 0 && tail->count < (size_type)WIDTH) {
+                    tail = unique_leaf(tail);
+                    ZJ_construct(tail->elems() + tail->count, std::forward<Args>(args)...);
+                    ++tail->count;
+                    ++cnt;
+                    return ;
+                }
+                if(tail != 0) {
+                    // the full tail becomes a leaf of the tree, args may still refer to it
+                    if((cnt >> BITS) > ((size_type)1 << shift)) {
+                        inner* new_root = new_inner();
+                        new_root->children[0] = root;
+                        new_root->children[1] = new_path(shift, tail);
+                        root = new_root;
+                        shift += BITS;
+                    }
+                    else root = push_tail(shift, root, tail);
+                }
+                leaf* l = new_leaf();
+                ZJ_construct(l->elems(), std::forward<Args>(args)...);
+                l->count = 1;
+                tail = l;
+                ++cnt;
+            }
+
+            void do_set(size_type idx, const T& value) {
+                if(idx >= tail_offset()) {
+                    tail = unique_leaf(tail);
+                    tail->elems()[idx & MASK] = value;
+                }
+                else root = assign(shift, root, idx, value);
+            }
+
+            void do_pop_back() {
+                if(tail->count > 1 || cnt == 1) {
+                    tail = unique_leaf(tail);
+                    --tail->count;
+                    ZJ_destroy(tail->elems() + tail->count);
+                    --cnt;
+                    if(cnt == 0) {
+                        release(tail, 0);
+                        tail = 0;
+                    }
+                    return ;
+                }
+                // the last leaf of the tree becomes the tail
+                leaf* new_tail = const_cast<leaf*>(leaf_for(cnt - 2));
+                acquire(new_tail);
+                root = pop_tail(shift, root);
+                if(shift > (size_type)BITS && static_cast<inner*>(root)->children[1] == 0) {
+                    node* new_root = static_cast<inner*>(root)->children[0];
+                    acquire(new_root);
+                    release(root, shift);
+                    root = new_root;
+                    shift -= BITS;
+                }
+                release(tail, 0);
+                tail = new_tail;
+                --cnt;
+            }
+
+            // a chain of new nodes from level down to l
+            node* new_path(size_type level, leaf* l) {
+                if(level == 0) return l;
+                inner* res = new_inner();
+                res->children[0] = new_path(level - BITS, l);
+                return res;
+            }
+
+            // takes our references to parent and l, l goes after the last leaf of the tree
+            inner* push_tail(size_type level, node* parent, leaf* l) {
+                inner* res = unique_inner(parent, level);
+                size_type sub = ((cnt - 1) >> level) & MASK;
+                if(level == (size_type)BITS) res->children[sub] = l;
+                else res->children[sub] = push_tail(level - BITS, res->children[sub], l);
+                return res;
+            }
+
+            // takes our reference to n, drops the last leaf below it; 0 if n ends up empty
+            node* pop_tail(size_type level, node* n) {
+                inner* res = unique_inner(n, level);
+                size_type sub = ((cnt - 2) >> level) & MASK;
+                if(level > (size_type)BITS) res->children[sub] = pop_tail(level - BITS, res->children[sub]);
+                else {
+                    release(res->children[sub], 0);
+                    res->children[sub] = 0;
+                }
+                if(sub == 0 && res->children[0] == 0) {
+                    release(res, level);
+                    return 0;
+                }
+                return res;
+            }
+
+            // takes our reference to n, copies the path to idx where it is shared
+            node* assign(size_type level, node* n, size_type idx, const T& value) {
+                if(level == 0) {
+                    leaf* l = unique_leaf(static_cast<leaf*>(n));
+                    l->elems()[idx & MASK] = value;
+                    return l;
+                }
+                inner* res = unique_inner(n, level);
+                size_type sub = (idx >> level) & MASK;
+                res->children[sub] = assign(level - BITS, res->children[sub], idx, value);
+                return res;
+            }
+    };
+
+    template <typename T, typename Alloc>
+    class transient_vector;
+
+    /**
+     * Immutable vector where every change returns a new version and leaves
+     * the old one untouched; versions share all the nodes they have in common.
+     * Copying is O(1) (a snapshot), set / push_back / pop_back copy one path
+     * of the 32-way trie, O(log32 n), and operator[] follows it.
+     * Readers may keep a snapshot on another thread while the writer moves on.
+     * For many changes in a row use a transient, it writes nodes it owns in place:
+     *
+     *      persistent_vector<int> v;
+     *      persistent_vector<int> v2 = v.push_back(1).push_back(2).set(0, 5);    // v is still empty
+     *      transient_vector<int> t = v2.transient();
+     *      for(int i = 0; i < n; ++i) t.push_back(i);
+     *      persistent_vector<int> v3 = t.persistent();
+    */
+    template <typename T, typename Alloc = ZJ::allocator<T>>
+    class persistent_vector : public __pvec_base<T, Alloc> {
+        friend class transient_vector<T, Alloc>;
+
+        protected :
+            typedef __pvec_base<T, Alloc> base;
+
+        public :
+            typedef persistent_vector_iterator<T, base>     const_iterator;
+            typedef const_iterator                          iterator;
+            typedef transient_vector<T, Alloc>              transient_type;
+            typedef typename base::size_type                size_type;
+
+            persistent_vector() {}
+
+            explicit persistent_vector(const Alloc& a) : base(a) {}
+
+            persistent_vector(size_type n, const T& value, const Alloc& a = Alloc()) : base(a) {
+                for(size_type i = 0; i < n; ++i) this->do_emplace_back(value);
+            }
+
+            persistent_vector(const persistent_vector& v) : base(v) {}
+
+            persistent_vector(persistent_vector&& v) : base(std::move(v)) {}
+
+            persistent_vector& operator= (const persistent_vector& rhs) {
+                persistent_vector tmp(rhs);
+                swap(tmp);
+                return *this;
+            }
+
+            persistent_vector& operator= (persistent_vector&& rhs) {
+                persistent_vector tmp(std::move(rhs));
+                swap(tmp);
+                return *this;
+            }
+
+            const_iterator begin() const {return const_iterator(this, 0);}
+
+            const_iterator cbegin() const {return begin();}
+
+            const_iterator end() const {return const_iterator(this, this->cnt);}
+
+            const_iterator cend() const {return end();}
+
+            // the versions with element idx replaced, value appended, the last element removed
+            persistent_vector set(size_type idx, const T& value) const {
+                persistent_vector res(*this);
+                res.do_set(idx, value);
+                return res;
+            }
+
+            persistent_vector push_back(const T& value) const {
+                persistent_vector res(*this);
+                res.do_emplace_back(value);
+                return res;
+            }
+
+            persistent_vector push_back(T&& value) const {
+                persistent_vector res(*this);
+                res.do_emplace_back(std::move(value));
+                return res;
+            }
+
+            template <typename... Args>
+            persistent_vector emplace_back(Args&&... args) const {
+                persistent_vector res(*this);
+                res.do_emplace_back(std::forward<Args>(args)...);
+                return res;
+            }
+
+            persistent_vector pop_back() const {
+                persistent_vector res(*this);
+                res.do_pop_back();
+                return res;
+            }
+
+            // O(1), shares the nodes until the transient writes them
+            transient_type transient() const {return transient_type(*this);}
+
+            void swap(persistent_vector& rhs) {this->swap_base(rhs);}
+    };
+
+    /**
+     * Batch builder for persistent_vector: same trie, changed in place.
+     * The first write to a node still shared with a persistent version copies
+     * it, every later write to it is free. persistent() hands the trie back
+     * in O(1) and leaves the transient empty.
+    */
+    template <typename T, typename Alloc = ZJ::allocator<T>>
+    class transient_vector : public __pvec_base<T, Alloc> {
+        friend class persistent_vector<T, Alloc>;
+
+        protected :
+            typedef __pvec_base<T, Alloc> base;
+
+            explicit transient_vector(const persistent_vector<T, Alloc>& v) : base(v) {}
+
+        public :
+            typedef typename base::size_type size_type;
+
+            transient_vector() {}
+
+            explicit transient_vector(const Alloc& a) : base(a) {}
+
+            transient_vector(transient_vector&& v) : base(std::move(v)) {}
+
+            transient_vector& operator= (transient_vector&& rhs) {
+                transient_vector tmp(std::move(rhs));
+                this->swap_base(tmp);
+                return *this;
+            }
+
+            void set(size_type idx, const T& value) {this->do_set(idx, value);}
+
+            void push_back(const T& value) {this->do_emplace_back(value);}
+
+            void push_back(T&& value) {this->do_emplace_back(std::move(value));}
+
+            template <typename... Args>
+            void emplace_back(Args&&... args) {this->do_emplace_back(std::forward<Args>(args)...);}
+
+            void pop_back() {this->do_pop_back();}
+
+            persistent_vector<T, Alloc> persistent() {
+                persistent_vector<T, Alloc> res(this->get_allocator());
+                res.swap_base(*this);
+                return res;
+            }
+
+        private :
+            // one owner at a time, a copy would write into nodes the other one sees
+            transient_vector(const transient_vector&);
+            transient_vector& operator= (const transient_vector&);
+    };
+
+}
+
+#endif
@@ -9,14 +9,20 @@ using namespace std;
 
 namespace ZJ {
 
-    template <typename T>
+    /**
+     * FIFO adaptor over any container with push_back / pop_front / front / back,
+     * deque by default; circular_buffer (ZJ_circular_buffer.h) is the cheaper
+     * one when the queue has a usual maximum length.
+     *      queue<event, circular_buffer<event>> q(circular_buffer<event>(1024));
+    */
+    template <typename T, typename Container = deque<T>>
     class queue {
 
         protected :
-            typedef deque<T>                              Container; 
             Container c;
 
         public : 
+            typedef Container                             container_type;
             typedef typename Container::value_type        value_type;
             typedef typename Container::reference         reference;
             typedef typename Container::const_reference   const_reference;
@@ -25,6 +31,10 @@ namespace ZJ {
 
             queue() : c() {}
 
+            explicit queue(const Container& ctr) : c(ctr) {}
+
+            explicit queue(Container&& ctr) : c(std::move(ctr)) {}
+
             bool empty() const { return c.empty(); }
 
             size_type size() const { return c.size(); }
@@ -39,6 +49,11 @@ namespace ZJ {
 
             void push(const value_type& value) { c.push_back(value); }
 
+            void push(value_type&& value) { c.push_back(std::move(value)); }
+
+            template <typename... Args>
+            void emplace(Args&&... args) { c.emplace_back(std::forward<Args>(args)...); }
+
             void pop() { c.pop_front(); }
         
     };
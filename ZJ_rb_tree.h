@@ -51,7 +51,7 @@ namespace ZJ {
         typedef rb_node<T>*     node_pointer;
         T data;
 
-        rb_node(COLOR_TYPE c, node_pointer_base p, node_pointer_base l, node_pointer_base r, T d) : 
+        rb_node(COLOR_TYPE c, node_pointer_base p, node_pointer_base l, node_pointer_base r, const T& d) : 
         rb_node_base(c, p, l, r), data(d) {}
 
         rb_node(rb_node<T>& rbn) {
@@ -104,12 +104,15 @@ namespace ZJ {
 
     };
 
-    template <typename T, typename pointer, typename reference>
+    template <typename T, typename Ptr, typename Ref>
     struct rb_iterator : rb_iterator_base {
         typedef T                                   value_type;
+        typedef Ptr                                 pointer;
+        typedef Ref                                 reference;
+        typedef ptrdiff_t                           difference_type;
         typedef rb_iterator<T, T*, T&>              iterator;
         typedef rb_iterator<T, const T*, const T&>  const_iterator;
-        typedef rb_iterator<T, pointer, reference>  self;
+        typedef rb_iterator<T, Ptr, Ref>            self;
         typedef rb_node<T>*                         node_pointer;
 
         rb_iterator() {}
@@ -151,10 +154,11 @@ namespace ZJ {
 
     };
 
-    template <typename Key, typename Value, typename KeyOfValue, typename Compare, typename Alloc = allocator<rb_node<Value>>>
-    class rb_tree {
+    template <typename Key, typename Value, typename KeyOfValue, typename Compare, typename Alloc = allocator<Value>>
+    class rb_tree : protected alloc_rebind<Alloc, rb_node<Value>>::other {
 
         public :
+            typedef Alloc           allocator_type;
             typedef Key             key_type;
             typedef Value           value_type;
             typedef Value*          pointer;
@@ -172,28 +176,30 @@ namespace ZJ {
             typedef rb_node<Value>* node_pointer;
 
         protected : 
+            typedef typename alloc_rebind<Alloc, rb_node<Value>>::other node_allocator;
+            typedef typename tag_and<typename alloc_traits<node_allocator>::IS_MONOTONIC, 
+                                     typename traits<Value>::HAS_TRIVIAL_DESTRUCTOR>::type skip_nodes_tag;
+            typedef node_batch<node_allocator> node_source;
+
             size_type node_count;
             node_pointer header;
             Compare key_compare;
 
         public : 
             rb_tree() : node_count(0), key_compare(Compare()) {
-                header = get_node();
-                root() = 0;
-                header->color = RED;
-                header->left = header;
-                header->right = header;
+                empty_initialize();
             }
 
-            rb_tree(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc>& rbt) {
-                header = get_node();
-                root() = 0;
-                header->color = RED;
-                header->left = header;
-                header->right = header;
+            explicit rb_tree(const Compare& comp, const Alloc& a = Alloc()) : node_allocator(a), node_count(0), key_compare(comp) {
+                empty_initialize();
+            }
+
+            rb_tree(const rb_tree& rbt) : node_allocator(rbt) {
+                empty_initialize();
                 key_compare = rbt.key_compare;
                 if(rbt.root() != 0) {
-                    copy_tree((base_pointer)rbt.root(), (base_pointer&)root());
+                    node_source batch(*this);
+                    copy_tree((base_pointer)rbt.root(), (base_pointer&)root(), &batch);
                     root()->parent = header;
                     header->parent = root();
                     leftmost() = (node_pointer)rb_node_base::minimum(base_pointer(root()));
@@ -204,7 +210,30 @@ namespace ZJ {
 
             ~rb_tree() {
                 clear();
-                put_node(header);
+                if(header != shared_header())
+                    put_node(header);
+            }
+
+            // takes rbt's nodes and header, rbt is left on the shared header
+            rb_tree(rb_tree&& rbt) : node_allocator(rbt), node_count(rbt.node_count), header(rbt.header), key_compare(rbt.key_compare) {
+                rbt.header = shared_header();
+                rbt.node_count = 0;
+            }
+
+            rb_tree& operator= (const rb_tree& rhs) {
+                if(this != &rhs) {
+                    rb_tree tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            rb_tree& operator= (rb_tree&& rhs) {
+                if(this != &rhs) {
+                    clear();
+                    swap(rhs);
+                }
+                return *this;
             }
 
             iterator begin() {return leftmost();}
@@ -225,10 +254,12 @@ namespace ZJ {
 
             Compare key_comp() const {return key_compare;}
 
+            allocator_type get_allocator() const {return allocator_type(*static_cast<const node_allocator*>(this));}
+
             void clear() {
                 if(node_count != 0) {
                     //erase(begin(), end());
-                    erase_aux(root());
+                    erase_aux(root(), skip_nodes_tag());
                     leftmost() = header;
                     root() = 0;
                     rightmost() = header;
@@ -237,49 +268,84 @@ namespace ZJ {
             }
 
             iterator insert_equal(const value_type& value) {
-                node_pointer x = root();
-                node_pointer y = header;
-                Key kov = KeyOfValue()(value);
-                while(x != 0) { 
-                    y = x;
-                    x = key_compare(kov, key(x)) ? left(x) : right(x);
-                }
-                return __insert(x, y, value);
+                return insert_equal_aux(value, 0);
             }
 
-            void insert_equal(iterator first, iterator last) {
-                while(first != last) {
-                    insert_equal(*first);
-                    ++first;
-                }
+            iterator insert_equal(value_type&& value) {
+                return insert_equal_aux(std::move(value), 0);
+            }
+
+            // nodes for a range come in batches when the allocator has a bulk allocate_n, see node_batch
+            template <typename InputIterator>
+            void insert_equal(InputIterator first, InputIterator last) {
+                node_source batch(*this);
+                for(; first != last; ++first)
+                    insert_equal_aux(*first, &batch);
             }
 
             pair<iterator, bool> insert_unique(const value_type& value) {
-                node_pointer x = root();
-                node_pointer y = header;
-                Key kov = KeyOfValue()(value);
-                bool cmp = true;
-                while(x != 0) {
-                    y = x;
-                    cmp = key_compare(kov, key(x));
-                    x = cmp ? left(x) : right(x);
+                return insert_unique_aux(value, 0);
+            }
+
+            pair<iterator, bool> insert_unique(value_type&& value) {
+                return insert_unique_aux(std::move(value), 0);
+            }
+
+            template <typename InputIterator>
+            void insert_unique(InputIterator first, InputIterator last) {
+                node_source batch(*this);
+                for(; first != last; ++first)
+                    insert_unique_aux(*first, &batch);
+            }
+
+            // the node is built first, the key comes from it
+            template <typename... Args>
+            iterator emplace_equal(Args&&... args) {
+                own_header();
+                node_pointer z = create_node(0, std::forward<Args>(args)...);
+                node_pointer x, y;
+                insert_equal_pos(key(z), x, y);
+                return __link(x, y, z);
+            }
+
+            template <typename... Args>
+            pair<iterator, bool> emplace_unique(Args&&... args) {
+                own_header();
+                node_pointer z = create_node(0, std::forward<Args>(args)...);
+                node_pointer x, y;
+                iterator j;
+                if(!insert_unique_pos(key(z), x, y, j)) {
+                    destroy_node(z);
+                    return pair<iterator, bool>(j, false);
                 }
-                iterator j = y;
-                if(cmp)
-                    if(j == begin()) 
-                        return pair<iterator, bool>(__insert(x, y, value), true);
-                    else
-                        --j;
-                if(key_compare(key(j.node), kov))
-                    return pair<iterator, bool>(__insert(x, y, value), true);
-                return pair<iterator, bool>(j, false);
-            }
-
-            void insert_unique(iterator first, iterator last) {
-                while(first != last) {
-                    insert_unique(*first);
-                    ++first;
+                return pair<iterator, bool>(__link(x, y, z), true);
+            }
+
+            // hint: the element goes right before it, if that keeps the order
+            // (appending sorted input with end() as hint is O(1) amortized)
+            template <typename... Args>
+            iterator emplace_hint_equal(iterator hint, Args&&... args) {
+                if(own_header()) hint = end();
+                node_pointer z = create_node(0, std::forward<Args>(args)...);
+                node_pointer x, y;
+                if(!hint_pos(hint, key(z), false, x, y))
+                    insert_equal_pos(key(z), x, y);
+                return __link(x, y, z);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint_unique(iterator hint, Args&&... args) {
+                if(own_header()) hint = end();
+                node_pointer z = create_node(0, std::forward<Args>(args)...);
+                node_pointer x, y;
+                if(!hint_pos(hint, key(z), true, x, y)) {
+                    iterator j;
+                    if(!insert_unique_pos(key(z), x, y, j)) {
+                        destroy_node(z);
+                        return j;
+                    }
                 }
+                return __link(x, y, z);
             }
 
             void erase(iterator pos) {
@@ -405,7 +471,8 @@ namespace ZJ {
                 return pair<const_iterator, const_iterator>(lower_bound(k), upper_bound(k));
             }
 
-            void swap(rb_tree<Key, Value, KeyOfValue, Compare>& rhs) {
+            void swap(rb_tree& rhs) {
+                ZJ_swap(static_cast<node_allocator&>(*this), static_cast<node_allocator&>(rhs));
                 ZJ_swap(header, rhs.header);
                 ZJ_swap(node_count, rhs.node_count);
                 ZJ_swap(key_compare, rhs.key_compare);
@@ -427,12 +494,87 @@ namespace ZJ {
             }
 
         protected :
-            iterator __insert(base_pointer x_, base_pointer y_, const value_type& value) {
+            // x, y: where a node with key k goes (see __link), after the equal keys
+            void insert_equal_pos(const Key& k, node_pointer& x, node_pointer& y) {
+                x = root();
+                y = header;
+                while(x != 0) { 
+                    y = x;
+                    x = key_compare(k, key(x)) ? left(x) : right(x);
+                }
+            }
+
+            // false if k is already there, j is then the element with key k
+            bool insert_unique_pos(const Key& k, node_pointer& x, node_pointer& y, iterator& j) {
+                x = root();
+                y = header;
+                bool cmp = true;
+                while(x != 0) {
+                    y = x;
+                    cmp = key_compare(k, key(x));
+                    x = cmp ? left(x) : right(x);
+                }
+                j = y;
+                if(cmp) {
+                    if(j == begin()) return true;
+                    --j;
+                }
+                return key_compare(key(j.node), k);
+            }
+
+            // x, y for a node with key k right before hint, false if that breaks the order
+            bool hint_pos(iterator hint, const Key& k, bool unique, node_pointer& x, node_pointer& y) {
+                if(hint.node == header) {
+                    if(node_count == 0) return false;
+                    node_pointer last = rightmost();
+                    if(unique ? !key_compare(key(last), k) : key_compare(k, key(last))) return false;
+                    x = 0; y = last;
+                    return true;
+                }
+                node_pointer h = (node_pointer)hint.node;
+                if(unique ? !key_compare(k, key(h)) : key_compare(key(h), k)) return false;
+                if(h == leftmost()) {
+                    x = h; y = h; // x != 0: left child of h
+                    return true;
+                }
+                iterator before = hint;
+                --before;
+                node_pointer b = (node_pointer)before.node;
+                if(unique ? !key_compare(key(b), k) : key_compare(k, key(b))) return false;
+                if(right(b) == 0) {x = 0; y = b;}
+                else {x = h; y = h;}
+                return true;
+            }
+
+            template <typename Arg>
+            iterator insert_equal_aux(Arg&& value, node_source* batch) {
+                own_header();
+                node_pointer x, y;
+                insert_equal_pos(KeyOfValue()(value), x, y);
+                return __insert(x, y, std::forward<Arg>(value), batch);
+            }
+
+            template <typename Arg>
+            pair<iterator, bool> insert_unique_aux(Arg&& value, node_source* batch) {
+                own_header();
+                node_pointer x, y;
+                iterator j;
+                if(!insert_unique_pos(KeyOfValue()(value), x, y, j))
+                    return pair<iterator, bool>(j, false);
+                return pair<iterator, bool>(__insert(x, y, std::forward<Arg>(value), batch), true);
+            }
+
+            template <typename Arg>
+            iterator __insert(base_pointer x_, base_pointer y_, Arg&& value, node_source* batch = 0) {
+                return __link(x_, y_, create_node(batch, std::forward<Arg>(value)));
+            }
+
+            // links z in as a child of y: the left one if y is the header, x != 0
+            // or z's key is less than y's, the right one otherwise
+            iterator __link(base_pointer x_, base_pointer y_, node_pointer z) {
                 node_pointer x = (node_pointer)x_;
                 node_pointer y = (node_pointer)y_;
-                node_pointer z; 
-                if(y == header || x != 0 || key_compare(KeyOfValue()(value), key(y))){
-                    z = create_node(value);
+                if(y == header || x != 0 || key_compare(key(z), key(y))){
                     left(y) = z;
                     if(y == header) {
                         root() = z;
@@ -441,7 +583,6 @@ namespace ZJ {
                     else if(y == leftmost()) leftmost() = z;
                 }
                 else {
-                    z = create_node(value);
                     right(y) = z;
                     if(y == rightmost()) rightmost() = z;
                 }
@@ -622,6 +763,11 @@ namespace ZJ {
                 }
             }
 
+            void erase_aux(base_pointer x, FALSE_TAG) {erase_aux(x);}
+
+            // monotonic allocator and nothing to destroy: the nodes are simply dropped
+            void erase_aux(base_pointer, TRUE_TAG) {}
+
             /** left rotate
              *          X                 Y
              *         / \               / \             
@@ -687,22 +833,55 @@ namespace ZJ {
             static COLOR_TYPE& color(node_pointer x) {return x->color;}
             static COLOR_TYPE& color(base_pointer x) {return ((node_pointer)x)->color;}
         
+            // the header holds no value, only its links are set up
+            void empty_initialize() {
+                header = get_node();
+                root() = 0;
+                header->color = RED;
+                header->left = header;
+                header->right = header;
+            }
+
+            // header of every moved-from tree of this type, never written to:
+            // such a tree reads as empty and gets a header of its own on its first insert
+            static node_pointer shared_header() {
+                static typename std::aligned_storage<sizeof(node), alignof(node)>::type storage;
+                static node_pointer h = init_shared_header((node_pointer)&storage);
+                return h;
+            }
+
+            static node_pointer init_shared_header(node_pointer h) {
+                h->color = RED;
+                h->parent = 0;
+                h->left = h;
+                h->right = h;
+                return h;
+            }
+
+            // true if the tree was on the shared header, an end() taken before is then stale
+            bool own_header() {
+                if(node_count != 0 || header != shared_header()) return false;
+                empty_initialize();
+                return true;
+            }
+
             node_pointer get_node() {
-                return Alloc::allocate(1);
+                return node_allocator::allocate(1);
             }
 
             void put_node(node_pointer ptr) {
-                Alloc::deallocate(ptr, sizeof(ptr));
+                node_allocator::deallocate(ptr, 1);
             }
 
-            node_pointer create_node(const value_type& value) {
-                node_pointer res = get_node();
-                ZJ_construct(&(res->data), value);
+            template <typename... Args>
+            node_pointer create_node(node_source* batch, Args&&... args) {
+                node_pointer res = batch ? batch->get() : get_node();
+                ZJ_construct(&(res->data), std::forward<Args>(args)...);
                 return res;
             }
 
-            node_pointer clone_node(node_pointer ptr) {
-                node_pointer res = create_node(ptr->data);
+            node_pointer clone_node(node_pointer ptr, node_source* batch) {
+                node_pointer res = create_node(batch, ptr->data);
                 res->color = ptr->color;
                 res->parent = 0;
                 res->left = 0;
@@ -714,22 +893,23 @@ namespace ZJ {
                 return res;*/
             }
 
-            void copy_tree(base_pointer from, base_pointer& to) {
+            // the copy's nodes come from batch, see node_batch
+            void copy_tree(base_pointer from, base_pointer& to, node_source* batch) {
                 if(from == 0) return ;
-                to = clone_node((node_pointer)from);
+                to = clone_node((node_pointer)from, batch);
                 if(from->left != 0) {
-                    copy_tree(from->left, to->left);
+                    copy_tree(from->left, to->left, batch);
                     to->left->parent = to;
                 }
                 if(from->right != 0) {
-                    copy_tree(from->right, to->right);
+                    copy_tree(from->right, to->right, batch);
                     to->right->parent = to;
                 }
             }
 
             void destroy_node(node_pointer ptr) {
                 ZJ_destroy(iterator(ptr));
-                Alloc::deallocate(ptr, sizeof(ptr));
+                node_allocator::deallocate(ptr, 1);
             }
 
     };
@@ -0,0 +1,377 @@
+
+
+
+#ifndef _ZJ_SEGMENTED_VECTOR_
+#define _ZJ_SEGMENTED_VECTOR_
+
+#include <cstddef>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+
+namespace ZJ {
+
+    /**
+     * Segment layout shared by segmented_vector and its iterator: segment k
+     * holds FIRST << k elements, so segments [0, k) hold FIRST * (2^k - 1)
+     * and element i is in segment msb(i + FIRST) - log2(FIRST).
+     * FIRST is a power of two, 0 picks about 512 bytes.
+    */
+    template <typename T, size_t FIRST>
+    struct __segment_layout {
+        static constexpr size_t floor_pow2(size_t n) {return n <= 1 ? 1 : 2 * floor_pow2(n / 2);}
+
+        static constexpr size_t log2(size_t n) {return n <= 1 ? 0 : 1 + log2(n / 2);}
+
+        static_assert((FIRST & (FIRST - 1)) == 0, "the first segment size must be a power of two");
+
+        enum {FIRST_SIZE = FIRST != 0 ? FIRST : floor_pow2(sizeof(T) < 512 ? 512 / sizeof(T) : 1)};
+        enum {FIRST_SHIFT = log2(FIRST_SIZE)};
+        enum {MAX_SEGMENTS = sizeof(size_t) * 8 - FIRST_SHIFT};
+
+        static size_t segment_of(size_t i) {return __ZJ_msb64((uint64_t)i + FIRST_SIZE) - FIRST_SHIFT;}
+
+        static size_t segment_size(size_t k) {return (size_t)FIRST_SIZE << k;}
+
+        // index of the first element of segment k
+        static size_t segment_start(size_t k) {return segment_size(k) - FIRST_SIZE;}
+    };
+
+    template <typename T, typename Ptr, typename Ref, size_t FIRST>
+    class segmented_vector_iterator : public iterator_base<random_access_iterator_tag, T> {
+        public :
+            typedef __segment_layout<T, FIRST>                              layout;
+            typedef segmented_vector_iterator<T, T*, T&, FIRST>             iterator;
+            typedef segmented_vector_iterator<T, Ptr, Ref, FIRST>           self;
+            typedef Ptr                                                     pointer;
+            typedef Ref                                                     reference;
+            typedef size_t                                                  size_type;
+            typedef ptrdiff_t                                               difference_type;
+
+            T* const* segments;
+            size_type index;
+            // [seg_start, seg_end) is the segment holding index, all 0 while it is not allocated
+            T* cur;
+            T* seg_start;
+            T* seg_end;
+
+            segmented_vector_iterator() : segments(0), index(0), cur(0), seg_start(0), seg_end(0) {}
+
+            segmented_vector_iterator(T* const* segs, size_type i) : segments(segs) {set_index(i);}
+
+            segmented_vector_iterator(const iterator& it) :
+                segments(it.segments), index(it.index), cur(it.cur), seg_start(it.seg_start), seg_end(it.seg_end) {}
+
+            reference operator* () const {return *cur;}
+
+            pointer operator-> () const {return cur;}
+
+            reference operator[] (difference_type n) const {return *(*this + n);}
+
+            self& operator++ () {
+                ++index;
+                if(cur == 0 || ++cur == seg_end) set_index(index);
+                return *this;
+            }
+
+            self& operator-- () {
+                if(cur == 0 || cur == seg_start) set_index(index - 1);
+                else --index, --cur;
+                return *this;
+            }
+
+            self operator++ (int) {
+                self res(*this);
+                ++*this;
+                return res;
+            }
+
+            self operator-- (int) {
+                self res(*this);
+                --*this;
+                return res;
+            }
+
+            self& operator+= (difference_type n) {
+                set_index(index + n);
+                return *this;
+            }
+
+            self& operator-= (difference_type n) {
+                set_index(index - n);
+                return *this;
+            }
+
+            self operator+ (difference_type n) const {
+                self res(*this);
+                return res += n;
+            }
+
+            self operator- (difference_type n) const {
+                self res(*this);
+                return res -= n;
+            }
+
+            difference_type operator- (const self& rhs) const {return (difference_type)index - (difference_type)rhs.index;}
+
+            bool operator== (const self& rhs) const {return index == rhs.index;}
+
+            bool operator!= (const self& rhs) const {return index != rhs.index;}
+
+            bool operator< (const self& rhs) const {return index < rhs.index;}
+
+        protected :
+            void set_index(size_type i) {
+                index = i;
+                size_type k = layout::segment_of(i);
+                seg_start = segments[k];
+                if(seg_start == 0) {
+                    cur = seg_end = 0;
+                    return ;
+                }
+                cur = seg_start + (i - layout::segment_start(k));
+                seg_end = seg_start + layout::segment_size(k);
+            }
+    };
+
+    /**
+     * Grows at the back without ever moving an element: segments of
+     * FIRST, 2 FIRST, 4 FIRST ... elements are added as needed and stay where
+     * they are, so pointers and references to elements stay valid until the
+     * element is popped. operator[] is O(1), one bit scan finds the segment.
+     * A push_back costs at most one allocation and never a copy of the
+     * elements, the worst case does not grow with size().
+     * Only the back changes (push / emplace / pop, resize); there is no
+     * insert / erase in the middle since it would have to move elements.
+     *
+     *      segmented_vector<order> book;
+     *      order* o = &book.emplace_back(...);            // stays valid while book grows
+    */
+    template <typename T, size_t FIRST = 0, typename Alloc = ZJ::allocator<T>>
+    class segmented_vector : protected Alloc {
+        public :
+            typedef T                                                       value_type;
+            typedef Alloc                                                   allocator_type;
+            typedef T*                                                      pointer;
+            typedef const T*                                                const_pointer;
+            typedef segmented_vector_iterator<T, T*, T&, FIRST>             iterator;
+            typedef segmented_vector_iterator<T, const T*, const T&, FIRST> const_iterator;
+            typedef T&                                                      reference;
+            typedef const T&                                                const_reference;
+            typedef size_t                                                  size_type;
+            typedef ptrdiff_t                                               difference_type;
+
+        protected :
+            typedef Alloc                           data_allocator;
+            typedef __segment_layout<T, FIRST>      layout;
+
+            // segments[k] is 0 until it is allocated; one slot past the last
+            // possible segment so end() of a full table has a 0 to look at
+            T* segments[layout::MAX_SEGMENTS + 1];
+            size_type num_elements;
+            size_type num_segments;
+
+        public :
+            segmented_vector() {empty_initialize();}
+
+            explicit segmented_vector(const Alloc& a) : Alloc(a) {empty_initialize();}
+
+            explicit segmented_vector(size_type n) {
+                empty_initialize();
+                resize(n);
+            }
+
+            segmented_vector(size_type n, const T& value, const Alloc& a = Alloc()) : Alloc(a) {
+                empty_initialize();
+                resize(n, value);
+            }
+
+            segmented_vector(const segmented_vector& v) : Alloc(v.get_allocator()) {
+                empty_initialize();
+                reserve(v.size());
+                for(size_type k = 0; num_elements < v.num_elements; ++k) {
+                    size_type n = v.num_elements - num_elements;
+                    if(n > layout::segment_size(k)) n = layout::segment_size(k);
+                    ZJ_uninitialized_copy(v.segments[k], v.segments[k] + n, segments[k]);
+                    num_elements += n;
+                }
+            }
+
+            segmented_vector(segmented_vector&& v) : Alloc(v.get_allocator()) {
+                empty_initialize();
+                steal(v);
+            }
+
+            ~segmented_vector() {
+                clear();
+                release_segments(0);
+            }
+
+            segmented_vector& operator= (const segmented_vector& rhs) {
+                if(this != &rhs) {
+                    segmented_vector tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            segmented_vector& operator= (segmented_vector&& rhs) {
+                if(this != &rhs) {
+                    clear();
+                    release_segments(0);
+                    static_cast<Alloc&>(*this) = static_cast<Alloc&>(rhs);
+                    steal(rhs);
+                }
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return *static_cast<const Alloc*>(this);}
+
+            iterator begin() {return iterator(segments, 0);}
+
+            const_iterator begin() const {return const_iterator(iterator((T* const*)segments, 0));}
+
+            const_iterator cbegin() const {return begin();}
+
+            iterator end() {return iterator(segments, num_elements);}
+
+            const_iterator end() const {return const_iterator(iterator((T* const*)segments, num_elements));}
+
+            const_iterator cend() const {return end();}
+
+            reference front() {return *segments[0];}
+
+            const_reference front() const {return *segments[0];}
+
+            reference back() {return (*this)[num_elements - 1];}
+
+            const_reference back() const {return (*this)[num_elements - 1];}
+
+            size_type size() const {return num_elements;}
+
+            size_type capacity() const {return layout::segment_start(num_segments);}
+
+            bool empty() const {return num_elements == 0;}
+
+            reference operator[] (size_type idx) {
+                size_type k = layout::segment_of(idx);
+                return segments[k][idx - layout::segment_start(k)];
+            }
+
+            const_reference operator[] (size_type idx) const {
+                size_type k = layout::segment_of(idx);
+                return segments[k][idx - layout::segment_start(k)];
+            }
+
+            // number of segments and segment k, for loops that want plain arrays
+            size_type segment_count() const {return num_segments;}
+
+            pointer segment_data(size_type k) {return segments[k];}
+
+            static size_type segment_size(size_type k) {return layout::segment_size(k);}
+
+            // adds segments, existing elements stay where they are
+            void reserve(size_type new_cap) {
+                while(capacity() < new_cap) add_segment();
+            }
+
+            // gives back the segments past the last element
+            void shrink_to_fit() {
+                release_segments(num_elements == 0 ? 0 : layout::segment_of(num_elements - 1) + 1);
+            }
+
+            void push_back(const value_type& value) {
+                emplace_back(value);
+            }
+
+            void push_back(value_type&& value) {
+                emplace_back(std::move(value));
+            }
+
+            // the new element is at a fixed address from now on
+            template <typename... Args>
+            reference emplace_back(Args&&... args) {
+                if(num_elements == capacity()) {
+                    // args may refer to an element, the new segment does not move it
+                    add_segment();
+                }
+                pointer p = &(*this)[num_elements];
+                ZJ_construct(p, std::forward<Args>(args)...);
+                ++num_elements;
+                return *p;
+            }
+
+            void pop_back() {
+                --num_elements;
+                ZJ_destroy(&(*this)[num_elements]);
+            }
+
+            void resize(size_type n) {
+                while(num_elements > n) pop_back();
+                reserve(n);
+                while(num_elements < n) emplace_back();
+            }
+
+            void resize(size_type n, const value_type& value) {
+                while(num_elements > n) pop_back();
+                reserve(n);
+                while(num_elements < n) emplace_back(value);
+            }
+
+            // keeps the segments
+            void clear() {
+                for(size_type k = 0; k < num_segments && layout::segment_start(k) < num_elements; ++k) {
+                    size_type n = num_elements - layout::segment_start(k);
+                    if(n > layout::segment_size(k)) n = layout::segment_size(k);
+                    ZJ_destroy(segments[k], segments[k] + n);
+                }
+                num_elements = 0;
+            }
+
+            void swap(segmented_vector& rhs) {
+                ZJ_swap(static_cast<Alloc&>(*this), static_cast<Alloc&>(rhs));
+                for(size_type k = 0; k <= (size_type)layout::MAX_SEGMENTS; ++k) ZJ_swap(segments[k], rhs.segments[k]);
+                ZJ_swap(num_elements, rhs.num_elements);
+                ZJ_swap(num_segments, rhs.num_segments);
+            }
+
+        protected :
+            void empty_initialize() {
+                for(size_type k = 0; k <= (size_type)layout::MAX_SEGMENTS; ++k) segments[k] = 0;
+                num_elements = 0;
+                num_segments = 0;
+            }
+
+            void add_segment() {
+                segments[num_segments] = data_allocator::allocate(layout::segment_size(num_segments));
+                ++num_segments;
+            }
+
+            // frees segments [k, num_segments), they hold no elements
+            void release_segments(size_type k) {
+                while(num_segments > k) {
+                    --num_segments;
+                    data_allocator::deallocate(segments[num_segments], layout::segment_size(num_segments));
+                    segments[num_segments] = 0;
+                }
+            }
+
+            // *this is empty and has no segments, takes v's; v is left empty
+            void steal(segmented_vector& v) {
+                for(size_type k = 0; k <= (size_type)layout::MAX_SEGMENTS; ++k) {
+                    segments[k] = v.segments[k];
+                    v.segments[k] = 0;
+                }
+                num_elements = v.num_elements;
+                num_segments = v.num_segments;
+                v.num_elements = v.num_segments = 0;
+            }
+    };
+
+    // a table of pointers to the heap, moving it moves the vector
+    template <typename T, size_t FIRST, typename Alloc>
+    struct is_trivially_relocatable<segmented_vector<T, FIRST, Alloc>> : is_trivially_relocatable<Alloc> {};
+
+}
+
+#endif
@@ -10,15 +10,16 @@
 
 namespace ZJ {
     
-    template <class Key, class Compare = ZJ::less<Key>>
+    template <class Key, class Compare = ZJ::less<Key>, class Alloc = allocator<Key>>
     class set {
         public : 
             typedef Key     key_type;
             typedef Key     value_type;
             typedef Compare key_compare;
             typedef Compare value_compare;
+            typedef Alloc   allocator_type;
 
-            typedef rb_tree<key_type, value_type, ZJ::identity<value_type>, Compare> Container;
+            typedef rb_tree<key_type, value_type, ZJ::identity<value_type>, Compare, Alloc> Container;
 
             typedef typename Container::const_pointer   pointer; // read-only
             typedef typename Container::const_pointer   const_pointer; // read-only
@@ -35,7 +36,23 @@ namespace ZJ {
         public : 
             set() : c() {}
 
-            set(const set<Key, Compare>& s) : c(s.c) {}
+            explicit set(const Compare& comp, const allocator_type& a = allocator_type()) : c(comp, a) {}
+
+            set(const set& s) : c(s.c) {}
+
+            set(set&& s) : c(std::move(s.c)) {}
+
+            set& operator= (const set& s) {
+                c = s.c;
+                return *this;
+            }
+
+            set& operator= (set&& s) {
+                c = std::move(s.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
 
             key_compare key_comp() const {return c.key_comp();}
 
@@ -59,6 +76,23 @@ namespace ZJ {
                 //return c.insert_unique(value);
             }
 
+            pair<iterator, bool> insert(value_type&& value) {
+                pair<typename Container::iterator, bool> p = c.insert_unique(std::move(value));
+                return pair<iterator, bool>(p.first, p.second);
+            }
+
+            template <typename... Args>
+            pair<iterator, bool> emplace(Args&&... args) {
+                pair<typename Container::iterator, bool> p = c.emplace_unique(std::forward<Args>(args)...);
+                return pair<iterator, bool>(p.first, p.second);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(iterator hint, Args&&... args) {
+                typedef typename Container::iterator iter;
+                return c.emplace_hint_unique((iter&)hint, std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_unique(first, last);
             }
@@ -123,15 +157,16 @@ namespace ZJ {
     };
 
 
-    template <class Key, class Compare = less<Key>>
+    template <class Key, class Compare = less<Key>, class Alloc = allocator<Key>>
     class multiset {
         public : 
             typedef Key    key_type;
             typedef Key     value_type;
             typedef Compare key_compare;
             typedef Compare value_compare;
+            typedef Alloc   allocator_type;
 
-            typedef rb_tree<key_type, value_type, ZJ::identity<value_type>, Compare> Container;
+            typedef rb_tree<key_type, value_type, ZJ::identity<value_type>, Compare, Alloc> Container;
 
             typedef typename Container::const_pointer   pointer; // read-only
             typedef typename Container::const_pointer   const_pointer; // read-only
@@ -148,7 +183,23 @@ namespace ZJ {
         public : 
             multiset() : c() {}
 
-            multiset(const multiset<Key, Compare>& ms) : c(ms.c) {}
+            explicit multiset(const Compare& comp, const allocator_type& a = allocator_type()) : c(comp, a) {}
+
+            multiset(const multiset& ms) : c(ms.c) {}
+
+            multiset(multiset&& ms) : c(std::move(ms.c)) {}
+
+            multiset& operator= (const multiset& ms) {
+                c = ms.c;
+                return *this;
+            }
+
+            multiset& operator= (multiset&& ms) {
+                c = std::move(ms.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
 
             key_compare key_comp() const {return c.key_comp();}
 
@@ -170,6 +221,21 @@ namespace ZJ {
                 return c.insert_equal(value);
             }
 
+            iterator insert(value_type&& value) {
+                return c.insert_equal(std::move(value));
+            }
+
+            template <typename... Args>
+            iterator emplace(Args&&... args) {
+                return c.emplace_equal(std::forward<Args>(args)...);
+            }
+
+            template <typename... Args>
+            iterator emplace_hint(iterator hint, Args&&... args) {
+                typedef typename Container::iterator iter;
+                return c.emplace_hint_equal((iter&)hint, std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_equal(first, last);
             }
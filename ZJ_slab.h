@@ -0,0 +1,216 @@
+
+
+
+#ifndef _ZJ_SLAB_
+#define _ZJ_SLAB_
+
+#include <cstddef>
+#include <mutex>
+#include "ZJ_alloc.h"
+
+namespace ZJ {
+
+    /**
+     * Slab allocator for fixed-size objects, one pool per type T.
+     * Containers rebind it to their node type (list_node, rb_node,
+     * hashtable_node), so every node type gets its own slabs: page-sized
+     * blocks carved into back-to-back slots of sizeof(T), no malloc header
+     * between them, and freed nodes go on an intrusive free list threaded
+     * through the slots themselves.
+     *
+     * Same two levels as __allocator_mp: a thread cache per type without
+     * locking, and a central list guarded by a mutex that is only touched
+     * in batches of __BATCH nodes. allocate_n() hands out many nodes with at
+     * most one trip to the central list, range inserts use it through
+     * ZJ_allocate_n / node_batch.
+     * Slabs are never given back to the system. Only single objects come from
+     * the slabs, allocate(n) with n != 1 (vector buffers, bucket arrays)
+     * goes to Alloc.
+     *
+     *      map<int, int, less<int>, slab_allocator<pair<const int, int>>> m;
+    */
+    template <typename T>
+    class slab_allocator {
+        public :
+            typedef T           value_type;
+            typedef T*          pointer;
+            typedef const T*    const_pointer;
+            typedef T&          reference;
+            typedef const T&    const_reference;
+            typedef size_t      size_type;
+            typedef ptrdiff_t   difference_type;
+
+            template<typename U>
+            struct rebind {
+                typedef slab_allocator<U> other;
+            };
+
+        private :
+            enum {__SLAB_SIZE = 4096};
+            enum {__MIN_OBJS = 8}; // objects per slab when T is big
+            enum {__BATCH = 32}; // nodes per transfer between thread cache and central list
+            enum {__MAX_CACHED = 2 * __BATCH};
+
+            union obj {
+                obj* next;
+                alignas(T) char data[sizeof(T)];
+            };
+
+            struct thread_cache {
+                obj* free_list;
+                size_t length;
+
+                thread_cache() : free_list(0), length(0) {}
+
+                ~thread_cache() {
+                    if(free_list != 0) {
+                        obj* last = free_list;
+                        while(last->next != 0) last = last->next;
+                        release_to_central(free_list, last);
+                    }
+                    free_list = 0;
+                    length = 0;
+                }
+            };
+
+            static thread_local thread_cache cache;
+
+            static mutex central_lock; // guards central_free_list
+            static obj* central_free_list;
+
+        public :
+            slab_allocator() {}
+
+            template <typename U>
+            slab_allocator(const slab_allocator<U>&) {}
+
+            static T* allocate(size_t n, void* = 0) {
+                __ZJ_ALLOC_HOOK(T, 0, n * sizeof(T));
+                if(n != 1) return (T*)Alloc::allocate(n * sizeof(T));
+                thread_cache& tc = cache;
+                obj* res = tc.free_list;
+                if(res == 0) {
+                    size_t got = __BATCH;
+                    res = fetch_from_central(got);
+                    tc.length = got;
+                }
+                tc.free_list = res->next;
+                --tc.length;
+                return (T*)res;
+            }
+
+            static void deallocate(T* p, size_t n) {
+                if(p == 0) return ;
+                __ZJ_DEALLOC_HOOK(T, p, n * sizeof(T));
+                if(n != 1) {
+                    Alloc::deallocate(p, n * sizeof(T));
+                    return ;
+                }
+                thread_cache& tc = cache;
+                obj* q = (obj*)p;
+                q->next = tc.free_list;
+                tc.free_list = q;
+                if(++tc.length > (size_t)__MAX_CACHED) {
+                    obj* last = q;
+                    for(int i = 1; i < __BATCH; ++i) last = last->next;
+                    tc.free_list = last->next;
+                    tc.length -= __BATCH;
+                    release_to_central(q, last);
+                }
+            }
+
+            // fills out[0, n) with single objects
+            static void allocate_n(T** out, size_t n) {
+            #ifdef ZJ_ALLOC_STATS
+                for(size_t k = 0; k < n; ++k) __ZJ_ALLOC_HOOK(T, 0, sizeof(T));
+            #endif
+                thread_cache& tc = cache;
+                size_t i = 0;
+                while(i < n) {
+                    if(tc.free_list == 0) {
+                        size_t got = n - i > (size_t)__BATCH ? n - i : (size_t)__BATCH;
+                        tc.free_list = fetch_from_central(got);
+                        tc.length = got;
+                    }
+                    for(; i < n && tc.free_list != 0; ++i) {
+                        out[i] = (T*)tc.free_list;
+                        tc.free_list = tc.free_list->next;
+                        --tc.length;
+                    }
+                }
+            }
+
+            bool operator== (const slab_allocator&) const {return true;}
+
+            bool operator!= (const slab_allocator&) const {return false;}
+
+        protected :
+            static size_t objs_per_slab() {
+                size_t n = (size_t)__SLAB_SIZE / sizeof(obj);
+                return n < (size_t)__MIN_OBJS ? (size_t)__MIN_OBJS : n;
+            }
+
+            // returns a chain of at least one and at most n objects, n is set to
+            // the number actually handed out
+            static obj* fetch_from_central(size_t& n) {
+                lock_guard<mutex> guard(central_lock);
+                if(central_free_list == 0) new_slabs(n);
+                obj* res = central_free_list;
+                obj* last = res;
+                size_t got = 1;
+                for(; got < n && last->next != 0; ++got) last = last->next;
+                central_free_list = last->next;
+                last->next = 0;
+                n = got;
+                return res;
+            }
+
+            // puts the chain [first, last] back on the central free list
+            static void release_to_central(obj* first, obj* last) {
+                lock_guard<mutex> guard(central_lock);
+                last->next = central_free_list;
+                central_free_list = first;
+            }
+
+            // carves enough slabs for at least n objects onto the central free list,
+            // central_lock must be held
+            static void new_slabs(size_t n) {
+                size_t per_slab = objs_per_slab();
+                size_t bytes = per_slab * sizeof(obj);
+                for(size_t made = 0; made < n; made += per_slab) {
+                    // over-allocate so the first slot can be aligned for T
+                    char* raw = (char*)Alloc::allocate(bytes + alignof(obj));
+                    obj* slab = (obj*)(((size_t)raw + alignof(obj) - 1) & ~(alignof(obj) - 1));
+                    for(size_t i = per_slab; i > 0; --i) {
+                        slab[i - 1].next = central_free_list;
+                        central_free_list = slab + i - 1;
+                    }
+                }
+            }
+    };
+
+    template <typename T>
+    inline void ZJ_allocate_n(slab_allocator<T>& a, T** out, size_t n) {
+        a.allocate_n(out, n);
+    }
+
+    template <typename T>
+    class alloc_traits<slab_allocator<T>> {
+        public :
+            typedef FALSE_TAG IS_MONOTONIC;
+            typedef FALSE_TAG HAS_REALLOCATE;
+            typedef TRUE_TAG HAS_ALLOCATE_N;
+    };
+
+    template <typename T>
+    thread_local typename slab_allocator<T>::thread_cache slab_allocator<T>::cache;
+
+    template <typename T>
+    mutex slab_allocator<T>::central_lock;
+
+    template <typename T>
+    typename slab_allocator<T>::obj* slab_allocator<T>::central_free_list = 0;
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+
+
+
+#ifndef _ZJ_SMALL_VECTOR_
+#define _ZJ_SMALL_VECTOR_
+
+#include <cstddef>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+#include "ZJ_vector.h"
+
+namespace ZJ {
+
+    /**
+     * vector with room for N elements inside the object itself: up to N
+     * elements it never allocates, the (N + 1)th moves everything to a heap
+     * buffer from Alloc and from then on it grows like vector. Same interface
+     * and iterator type as vector; iterators are invalidated by moving or
+     * swapping the small_vector while it is inline.
+     *
+     *      small_vector<int, 8> adj[V];                    // adjacency lists, no allocation for degree <= 8
+     *      map<int, small_vector<string, 4>> values;
+    */
+    template <typename T, size_t N, typename Alloc = ZJ::allocator<T>>
+    class small_vector : public __vector_base<T, Alloc, small_vector<T, N, Alloc>> {
+        static_assert(N > 0, "small_vector needs room for at least one inline element");
+
+        friend class __vector_base<T, Alloc, small_vector<T, N, Alloc>>;
+
+        protected :
+            typedef __vector_base<T, Alloc, small_vector<T, N, Alloc>> base;
+            typedef Alloc vector_allocator;
+
+        public :
+            typedef typename base::iterator         iterator;
+            typedef typename base::const_iterator   const_iterator;
+            typedef typename base::pointer          pointer;
+            typedef typename base::const_pointer    const_pointer;
+            typedef typename base::size_type        size_type;
+
+        protected :
+            alignas(T) unsigned char buffer[N * sizeof(T)];
+
+        public :
+            small_vector() {inline_initialize();}
+
+            explicit small_vector(const Alloc& a) : base(a) {inline_initialize();}
+
+            small_vector(size_type n) {
+                inline_initialize();
+                this->insert(this->end(), n, T());
+            }
+
+            small_vector(size_type n, const T& value, const Alloc& a = Alloc()) : base(a) {
+                inline_initialize();
+                this->insert(this->end(), n, value);
+            }
+
+            small_vector(const_iterator first, const_iterator last, const Alloc& a = Alloc()) : base(a) {
+                inline_initialize();
+                this->reserve(last - first);
+                this->finish = ZJ_uninitialized_copy(first, last, this->begin());
+            }
+
+            small_vector(const small_vector& v) : base(v.get_allocator()) {
+                inline_initialize();
+                this->reserve(v.size());
+                this->finish = ZJ_uninitialized_copy(v.begin(), v.end(), this->begin());
+            }
+
+            small_vector(small_vector&& v) : base(v.get_allocator()) {
+                inline_initialize();
+                steal(v);
+            }
+
+            ~small_vector() {
+                ZJ_destroy(this->start, this->finish);
+                release_storage();
+            }
+
+            small_vector& operator= (const small_vector& rhs) {
+                if(this != &rhs) {
+                    small_vector tmp(rhs);
+                    *this = std::move(tmp);
+                }
+                return *this;
+            }
+
+            small_vector& operator= (small_vector&& rhs) {
+                if(this != &rhs) {
+                    ZJ_destroy(this->start, this->finish);
+                    release_storage();
+                    inline_initialize();
+                    static_cast<Alloc&>(*this) = static_cast<Alloc&>(rhs);
+                    steal(rhs);
+                }
+                return *this;
+            }
+
+            // true while the elements live in the object itself
+            bool is_inline() const {return this->start.operator->() == inline_data();}
+
+            // back to the inline buffer when the elements fit, capacity becomes size otherwise
+            void shrink_to_fit() {
+                if(is_inline() || this->finish == this->storage_end) return ;
+                if(this->size() <= N) reallocate_storage(this->size(), FALSE_TAG());
+                else reallocate_storage(this->size(), typename base::realloc_tag());
+            }
+
+            void swap(small_vector& rhs) {
+                small_vector tmp(std::move(rhs));
+                rhs = std::move(*this);
+                *this = std::move(tmp);
+            }
+
+        protected :
+            pointer inline_data() {return (pointer)buffer;}
+
+            const_pointer inline_data() const {return (const_pointer)buffer;}
+
+            void inline_initialize() {
+                this->start = this->finish = inline_data();
+                this->storage_end = this->start + N;
+            }
+
+            void release_storage() {
+                if(!is_inline()) base::release_storage();
+            }
+
+            // *this is empty and inline: takes v's heap buffer, or relocates v's
+            // inline elements into its own buffer; v is left empty
+            void steal(small_vector& v) {
+                if(v.is_inline()) {
+                    this->finish = ZJ_relocate(v.start, v.finish, this->start);
+                    v.finish = v.start;
+                }
+                else {
+                    this->start = v.start;
+                    this->finish = v.finish;
+                    this->storage_end = v.storage_end;
+                    v.inline_initialize();
+                }
+            }
+
+            // as in __vector_base, but into the inline buffer when new_cap <= N;
+            // only heap buffers are grown with reallocate, the inline buffer is relocated out
+            void reallocate_storage(size_type new_cap, TRUE_TAG) {
+                if(is_inline() || new_cap <= N) reallocate_storage(new_cap, FALSE_TAG());
+                else base::reallocate_storage(new_cap, TRUE_TAG());
+            }
+
+            void reallocate_storage(size_type new_cap, FALSE_TAG) {
+                if(new_cap > N) {
+                    base::reallocate_storage(new_cap, FALSE_TAG());
+                    return ;
+                }
+                if(is_inline()) return ;
+                pointer old = this->data();
+                size_type n = this->size();
+                size_type old_cap = this->capacity();
+                inline_initialize();
+                this->finish = ZJ_relocate(iterator(old), iterator(old + n), this->start);
+                vector_allocator::deallocate(old, old_cap);
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,530 @@
+
+
+
+#ifndef _ZJ_SOA_VECTOR_
+#define _ZJ_SOA_VECTOR_
+
+#include <cstddef>
+#include <tuple>
+#include "ZJ_alloc.h"
+#include "ZJ_utils.h"
+#include "ZJ_iterator.h"
+
+namespace ZJ {
+
+    // 0, 1, ..., N - 1 as a pack, to run one statement per column
+    template <size_t... I>
+    struct __soa_index_seq {};
+
+    template <size_t N, size_t... I>
+    struct __soa_make_index_seq : __soa_make_index_seq<N - 1, N - 1, I...> {};
+
+    template <size_t... I>
+    struct __soa_make_index_seq<0, I...> {
+        typedef __soa_index_seq<I...> type;
+    };
+
+    // contiguous run of T, what soa_vector::column returns
+    template <typename T>
+    class span {
+        public :
+            typedef T           value_type;
+            typedef T*          pointer;
+            typedef T*          iterator;
+            typedef T&          reference;
+            typedef size_t      size_type;
+
+        protected :
+            T* ptr;
+            size_type len;
+
+        public :
+            span() : ptr(0), len(0) {}
+
+            span(T* p, size_type n) : ptr(p), len(n) {}
+
+            iterator begin() const {return ptr;}
+
+            iterator end() const {return ptr + len;}
+
+            pointer data() const {return ptr;}
+
+            size_type size() const {return len;}
+
+            bool empty() const {return len == 0;}
+
+            reference operator[] (size_type idx) const {return ptr[idx];}
+    };
+
+    // row index into a soa_vector, dereferences to the row proxy Ref
+    template <typename Vec, typename VecPtr, typename Ref>
+    class soa_iterator : public iterator_base<random_access_iterator_tag, typename Vec::value_type> {
+        public :
+            typedef soa_iterator<Vec, VecPtr, Ref>  self;
+            typedef Ref                             reference;
+            typedef void                            pointer;
+            typedef size_t                          size_type;
+            typedef ptrdiff_t                       difference_type;
+
+            VecPtr vec;
+            size_type index;
+
+            soa_iterator() : vec(0), index(0) {}
+
+            soa_iterator(VecPtr v, size_type i) : vec(v), index(i) {}
+
+            // iterator -> const_iterator
+            template <typename P, typename R>
+            soa_iterator(const soa_iterator<Vec, P, R>& it) : vec(it.vec), index(it.index) {}
+
+            reference operator* () const {return reference(vec, index);}
+
+            reference operator[] (difference_type n) const {return reference(vec, index + n);}
+
+            self& operator++ () {
+                ++index;
+                return *this;
+            }
+
+            self& operator-- () {
+                --index;
+                return *this;
+            }
+
+            self operator++ (int) {
+                self res(*this);
+                ++index;
+                return res;
+            }
+
+            self operator-- (int) {
+                self res(*this);
+                --index;
+                return res;
+            }
+
+            self& operator+= (difference_type n) {
+                index += n;
+                return *this;
+            }
+
+            self& operator-= (difference_type n) {
+                index -= n;
+                return *this;
+            }
+
+            self operator+ (difference_type n) const {return self(vec, index + n);}
+
+            self operator- (difference_type n) const {return self(vec, index - n);}
+
+            difference_type operator- (const self& rhs) const {return (difference_type)index - (difference_type)rhs.index;}
+
+            bool operator== (const self& rhs) const {return index == rhs.index;}
+
+            bool operator!= (const self& rhs) const {return index != rhs.index;}
+
+            bool operator< (const self& rhs) const {return index < rhs.index;}
+    };
+
+    /**
+     * Structure of arrays: a table of rows (Fields...) where every field has
+     * its own contiguous column, so a loop over one field reads only that
+     * field and the compiler can vectorize it:
+     *
+     *      soa_vector<int, double, string> orders;      // id, price, name
+     *      orders.push_back(7, 99.5, "AAPL");
+     *      span<double> price = orders.column<1>();
+     *      for(size_t i = 0; i < price.size(); ++i) total += price[i];
+     *
+     * All columns share one block from Alloc and the same capacity; every
+     * column starts on a COLUMN_ALIGN (64) byte boundary relative to the block,
+     * so with aligned_allocator<char> they are cache line aligned.
+     * Rows are reached through a proxy: v[i].get<I>() is a reference to field
+     * I of row i, and the proxy converts to / from value_type (std::tuple).
+     * push / insert / erase work on every column together. Growing relocates
+     * each column into the new block (a memmove for trivially relocatable fields).
+    */
+    template <typename Alloc, typename... Fields>
+    class basic_soa_vector : protected alloc_rebind<Alloc, char>::other {
+        static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+
+        public :
+            typedef basic_soa_vector<Alloc, Fields...>                      self;
+            typedef std::tuple<Fields...>                                   value_type;
+            typedef typename alloc_rebind<Alloc, char>::other               allocator_type;
+            typedef size_t                                                  size_type;
+            typedef ptrdiff_t                                               difference_type;
+
+            enum {NUM_FIELDS = sizeof...(Fields)};
+            enum {COLUMN_ALIGN = 64};
+
+            template <size_t I>
+            using field_type = typename std::tuple_element<I, value_type>::type;
+
+            // row proxy, holds the vector and a row index
+            class reference {
+                public :
+                    self* vec;
+                    size_type index;
+
+                    reference(self* v, size_type i) : vec(v), index(i) {}
+
+                    template <size_t I>
+                    field_type<I>& get() const {return vec->template data<I>()[index];}
+
+                    operator value_type() const {return vec->row_tuple(index, indices());}
+
+                    // assigns field by field
+                    const reference& operator= (const value_type& row) const {
+                        vec->assign_row(index, row, indices());
+                        return *this;
+                    }
+
+                    const reference& operator= (const reference& rhs) const {return *this = (value_type)rhs;}
+            };
+
+            class const_reference {
+                public :
+                    const self* vec;
+                    size_type index;
+
+                    const_reference(const self* v, size_type i) : vec(v), index(i) {}
+
+                    const_reference(const reference& r) : vec(r.vec), index(r.index) {}
+
+                    template <size_t I>
+                    const field_type<I>& get() const {return vec->template data<I>()[index];}
+
+                    operator value_type() const {return vec->row_tuple(index, indices());}
+            };
+
+            typedef soa_iterator<self, self*, reference>                    iterator;
+            typedef soa_iterator<self, const self*, const_reference>        const_iterator;
+
+        protected :
+            typedef allocator_type                                      block_allocator;
+            typedef typename __soa_make_index_seq<NUM_FIELDS>::type     indices;
+
+            char* block;
+            void* columns[NUM_FIELDS];
+            size_type num_rows;
+            size_type cap;
+
+        public :
+            basic_soa_vector() {empty_initialize();}
+
+            explicit basic_soa_vector(const allocator_type& a) : block_allocator(a) {empty_initialize();}
+
+            explicit basic_soa_vector(size_type n) {
+                empty_initialize();
+                resize(n);
+            }
+
+            basic_soa_vector(const basic_soa_vector& v) : block_allocator(v.get_allocator()) {
+                empty_initialize();
+                reserve(v.size());
+                copy_columns(v, indices());
+                num_rows = v.num_rows;
+            }
+
+            basic_soa_vector(basic_soa_vector&& v) : block_allocator(v.get_allocator()) {
+                empty_initialize();
+                steal(v);
+            }
+
+            ~basic_soa_vector() {
+                clear();
+                release_storage();
+            }
+
+            basic_soa_vector& operator= (const basic_soa_vector& rhs) {
+                if(this != &rhs) {
+                    basic_soa_vector tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            basic_soa_vector& operator= (basic_soa_vector&& rhs) {
+                if(this != &rhs) {
+                    clear();
+                    release_storage();
+                    empty_initialize();
+                    static_cast<block_allocator&>(*this) = static_cast<block_allocator&>(rhs);
+                    steal(rhs);
+                }
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return *static_cast<const block_allocator*>(this);}
+
+            iterator begin() {return iterator(this, 0);}
+
+            const_iterator begin() const {return const_iterator(this, 0);}
+
+            const_iterator cbegin() const {return begin();}
+
+            iterator end() {return iterator(this, num_rows);}
+
+            const_iterator end() const {return const_iterator(this, num_rows);}
+
+            const_iterator cend() const {return end();}
+
+            reference front() {return reference(this, 0);}
+
+            const_reference front() const {return const_reference(this, 0);}
+
+            reference back() {return reference(this, num_rows - 1);}
+
+            const_reference back() const {return const_reference(this, num_rows - 1);}
+
+            reference operator[] (size_type idx) {return reference(this, idx);}
+
+            const_reference operator[] (size_type idx) const {return const_reference(this, idx);}
+
+            size_type size() const {return num_rows;}
+
+            size_type capacity() const {return cap;}
+
+            bool empty() const {return num_rows == 0;}
+
+            // column I as a plain array of size() elements
+            template <size_t I>
+            field_type<I>* data() {return (field_type<I>*)columns[I];}
+
+            template <size_t I>
+            const field_type<I>* data() const {return (const field_type<I>*)columns[I];}
+
+            template <size_t I>
+            span<field_type<I>> column() {return span<field_type<I>>(data<I>(), num_rows);}
+
+            template <size_t I>
+            span<const field_type<I>> column() const {return span<const field_type<I>>(data<I>(), num_rows);}
+
+            void reserve(size_type new_cap) {
+                if(new_cap > cap) reallocate_storage(new_cap);
+            }
+
+            void shrink_to_fit() {
+                if(num_rows != cap) reallocate_storage(num_rows);
+            }
+
+            void push_back(const Fields&... values) {
+                emplace_back(values...);
+            }
+
+            void push_back(Fields&&... values) {
+                emplace_back(std::move(values)...);
+            }
+
+            void push_back(const value_type& row) {
+                if(num_rows == cap) {
+                    // row may be read from this vector's columns
+                    value_type tmp(row);
+                    grow(1);
+                    construct_row(num_rows, std::move(tmp), indices());
+                }
+                else construct_row(num_rows, row, indices());
+                ++num_rows;
+            }
+
+            // one argument per field, field I is constructed from args I
+            template <typename... Args>
+            void emplace_back(Args&&... args) {
+                static_assert(sizeof...(Args) == NUM_FIELDS, "emplace_back takes one argument per field");
+                if(num_rows == cap) {
+                    // args may refer to elements that are about to be moved
+                    value_type tmp(std::forward<Args>(args)...);
+                    grow(1);
+                    construct_row(num_rows, std::move(tmp), indices());
+                }
+                else construct_fields(num_rows, indices(), std::forward<Args>(args)...);
+                ++num_rows;
+            }
+
+            void pop_back() {
+                --num_rows;
+                destroy_rows(num_rows, num_rows + 1, indices());
+            }
+
+            iterator insert(iterator pos, const Fields&... values) {
+                return insert(pos, value_type(values...));
+            }
+
+            iterator insert(iterator pos, const value_type& row) {
+                size_type index = pos.index;
+                if(index == num_rows) {
+                    push_back(row);
+                    return pos;
+                }
+                value_type tmp(row);
+                if(num_rows == cap) grow(1);
+                relocate_rows(index, num_rows, index + 1, indices());
+                construct_row(index, std::move(tmp), indices());
+                ++num_rows;
+                return iterator(this, index);
+            }
+
+            iterator erase(iterator pos) {
+                return erase(pos, pos + 1);
+            }
+
+            iterator erase(iterator first, iterator last) {
+                size_type i = first.index, j = last.index;
+                if(i == j) return first;
+                destroy_rows(i, j, indices());
+                relocate_rows(j, num_rows, i, indices());
+                num_rows -= j - i;
+                return iterator(this, i);
+            }
+
+            // new rows are value initialized
+            void resize(size_type n) {
+                if(n < num_rows) {
+                    destroy_rows(n, num_rows, indices());
+                    num_rows = n;
+                    return ;
+                }
+                reserve(n);
+                for(; num_rows < n; ++num_rows) construct_fields(num_rows, indices(), Fields()...);
+            }
+
+            // keeps the block
+            void clear() {
+                destroy_rows(0, num_rows, indices());
+                num_rows = 0;
+            }
+
+            void swap(basic_soa_vector& rhs) {
+                ZJ_swap(static_cast<block_allocator&>(*this), static_cast<block_allocator&>(rhs));
+                ZJ_swap(block, rhs.block);
+                for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) ZJ_swap(columns[k], rhs.columns[k]);
+                ZJ_swap(num_rows, rhs.num_rows);
+                ZJ_swap(cap, rhs.cap);
+            }
+
+        protected :
+            static size_type field_size(size_type k) {
+                static const size_type sizes[] = {sizeof(Fields)...};
+                return sizes[k];
+            }
+
+            static size_type field_align(size_type k) {
+                static const size_type aligns[] = {alignof(Fields)...};
+                return aligns[k] > (size_type)COLUMN_ALIGN ? aligns[k] : (size_type)COLUMN_ALIGN;
+            }
+
+            // bytes of a block for n rows; with cols, also where each column starts
+            static size_type layout(size_type n, char* base = 0, void** cols = 0) {
+                size_type off = 0;
+                for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) {
+                    off = (off + field_align(k) - 1) / field_align(k) * field_align(k);
+                    if(cols) cols[k] = base + off;
+                    off += n * field_size(k);
+                }
+                return off;
+            }
+
+            void empty_initialize() {
+                block = 0;
+                for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) columns[k] = 0;
+                num_rows = cap = 0;
+            }
+
+            void release_storage() {
+                if(block) block_allocator::deallocate(block, layout(cap));
+            }
+
+            // *this is empty and has no block, takes v's; v is left empty
+            void steal(basic_soa_vector& v) {
+                block = v.block;
+                for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) columns[k] = v.columns[k];
+                num_rows = v.num_rows;
+                cap = v.cap;
+                v.empty_initialize();
+            }
+
+            // room for n more rows
+            void grow(size_type n) {
+                reallocate_storage(n > num_rows ? num_rows + n : 2 * num_rows);
+            }
+
+            // moves every column into a new block of new_cap >= size() rows
+            void reallocate_storage(size_type new_cap) {
+                char* new_block = 0;
+                void* new_columns[NUM_FIELDS];
+                if(new_cap) {
+                    new_block = block_allocator::allocate(layout(new_cap));
+                    layout(new_cap, new_block, new_columns);
+                }
+                else for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) new_columns[k] = 0;
+                relocate_columns(new_columns, indices());
+                release_storage();
+                block = new_block;
+                for(size_type k = 0; k < (size_type)NUM_FIELDS; ++k) columns[k] = new_columns[k];
+                cap = new_cap;
+            }
+
+            template <size_t... I>
+            void relocate_columns(void** new_columns, __soa_index_seq<I...>) {
+                int expand[] = {0, ((void)ZJ_relocate(data<I>(), data<I>() + num_rows, (field_type<I>*)new_columns[I]), 0)...};
+                (void)expand;
+            }
+
+            // rows [first, last) -> [dest, dest + last - first) in every column, overlapping like memmove
+            template <size_t... I>
+            void relocate_rows(size_type first, size_type last, size_type dest, __soa_index_seq<I...>) {
+                if(dest < first) {
+                    int expand[] = {0, ((void)ZJ_relocate(data<I>() + first, data<I>() + last, data<I>() + dest), 0)...};
+                    (void)expand;
+                }
+                else {
+                    int expand[] = {0, ((void)ZJ_relocate_backward(data<I>() + first, data<I>() + last, data<I>() + dest + (last - first)), 0)...};
+                    (void)expand;
+                }
+            }
+
+            template <size_t... I>
+            void destroy_rows(size_type first, size_type last, __soa_index_seq<I...>) {
+                int expand[] = {0, ((void)ZJ_destroy(data<I>() + first, data<I>() + last), 0)...};
+                (void)expand;
+            }
+
+            template <size_t... I, typename... Args>
+            void construct_fields(size_type i, __soa_index_seq<I...>, Args&&... args) {
+                int expand[] = {0, ((void)ZJ_construct(data<I>() + i, std::forward<Args>(args)), 0)...};
+                (void)expand;
+            }
+
+            template <typename Row, size_t... I>
+            void construct_row(size_type i, Row&& row, __soa_index_seq<I...>) {
+                int expand[] = {0, ((void)ZJ_construct(data<I>() + i, std::get<I>(std::forward<Row>(row))), 0)...};
+                (void)expand;
+            }
+
+            template <size_t... I>
+            void assign_row(size_type i, const value_type& row, __soa_index_seq<I...>) {
+                int expand[] = {0, ((void)(data<I>()[i] = std::get<I>(row)), 0)...};
+                (void)expand;
+            }
+
+            template <size_t... I>
+            value_type row_tuple(size_type i, __soa_index_seq<I...>) const {return value_type(data<I>()[i]...);}
+
+            template <size_t... I>
+            void copy_columns(const basic_soa_vector& v, __soa_index_seq<I...>) {
+                int expand[] = {0, ((void)ZJ_uninitialized_copy(v.template data<I>(), v.template data<I>() + v.num_rows, data<I>()), 0)...};
+                (void)expand;
+            }
+    };
+
+    template <typename... Fields>
+    using soa_vector = basic_soa_vector<allocator<char>, Fields...>;
+
+    // columns are pointers into the block, moving it moves the vector
+    template <typename Alloc, typename... Fields>
+    struct is_trivially_relocatable<basic_soa_vector<Alloc, Fields...>> : is_trivially_relocatable<Alloc> {};
+
+}
+
+#endif
@@ -1,7 +1,7 @@
 
 
-#ifndef _ZJ_UNORDERED_SET_
-#define _ZJ_UNORDERED_SET_
+#ifndef _ZJ_UNORDERED_MAP_
+#define _ZJ_UNORDERED_MAP_
 
 #include "ZJ_hashtable.h"
 #include "ZJ_functional.h"
@@ -10,7 +10,7 @@
 
 namespace ZJ {
 
-    template <class Key, class Value, class HashFcn = hash<Key>, class KeyEquals = equal<Key>>
+    template <class Key, class Value, class HashFcn = hash<Key>, class KeyEquals = equal<Key>, class Alloc = allocator<pair<const Key, Value>>>
     class unordered_map {
         public : 
             typedef Key                    key_type;
@@ -18,9 +18,10 @@ namespace ZJ {
             typedef pair<const Key, Value> value_type;
             typedef HashFcn                hasher;
             typedef KeyEquals              key_equal;
+            typedef Alloc                  allocator_type;
         
         private :
-            typedef hashtable<key_type, value_type, hasher, select1st<value_type>, key_equal> Container;
+            typedef hashtable<key_type, value_type, hasher, select1st<value_type>, key_equal, Alloc> Container;
             Container c;
         
         public : 
@@ -41,8 +42,24 @@ namespace ZJ {
 
             unordered_map(size_type n, const hasher& hf, const key_equal& eql) : c(n, hf, eql) {}
 
+            unordered_map(size_type n, const hasher& hf, const key_equal& eql, const allocator_type& a) : c(n, hf, eql, a) {}
+
             unordered_map(const unordered_map& um) : c(um.c) {}
 
+            unordered_map(unordered_map&& um) : c(std::move(um.c)) {}
+
+            unordered_map& operator= (const unordered_map& um) {
+                c = um.c;
+                return *this;
+            }
+
+            unordered_map& operator= (unordered_map&& um) {
+                c = std::move(um.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
+
             data_type& operator[] (const key_type& k) {
                 return (*(insert(value_type(k, data_type())).first)).second;
             }
@@ -73,6 +90,15 @@ namespace ZJ {
                 return c.insert_unique(value);
             }
 
+            pair<iterator, bool> insert(value_type&& value) {
+                return c.insert_unique(std::move(value));
+            }
+
+            template <typename... Args>
+            pair<iterator, bool> emplace(Args&&... args) {
+                return c.emplace_unique(std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_unique(first, last);
             }
@@ -108,7 +134,7 @@ namespace ZJ {
             }
     };
 
-    template <class Key, class Value, class HashFcn = hash<Key>, class KeyEquals = equal<Key>>
+    template <class Key, class Value, class HashFcn = hash<Key>, class KeyEquals = equal<Key>, class Alloc = allocator<pair<const Key, Value>>>
     class unordered_multimap {
         public : 
             typedef Key                    key_type;
@@ -116,9 +142,10 @@ namespace ZJ {
             typedef pair<const Key, Value> value_type;
             typedef HashFcn                hasher;
             typedef KeyEquals              key_equal;
+            typedef Alloc                  allocator_type;
         
         private :
-            typedef hashtable<key_type, value_type, hasher, select1st<value_type>, key_equal> Container;
+            typedef hashtable<key_type, value_type, hasher, select1st<value_type>, key_equal, Alloc> Container;
             Container c;
         
         public : 
@@ -139,8 +166,24 @@ namespace ZJ {
 
             unordered_multimap(size_type n, const hasher& hf, const key_equal& eql) : c(n, hf, eql) {}
 
+            unordered_multimap(size_type n, const hasher& hf, const key_equal& eql, const allocator_type& a) : c(n, hf, eql, a) {}
+
             unordered_multimap(const unordered_multimap& um) : c(um.c) {}
 
+            unordered_multimap(unordered_multimap&& um) : c(std::move(um.c)) {}
+
+            unordered_multimap& operator= (const unordered_multimap& um) {
+                c = um.c;
+                return *this;
+            }
+
+            unordered_multimap& operator= (unordered_multimap&& um) {
+                c = std::move(um.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
+
             // [] operator is not supported for unordered_multimap
 
             hasher hash_function() const {return c.hash_function();}
@@ -173,6 +216,15 @@ namespace ZJ {
                 return c.insert_equal(value);
             }
 
+            iterator insert(value_type&& value) {
+                return c.insert_equal(std::move(value));
+            }
+
+            template <typename... Args>
+            iterator emplace(Args&&... args) {
+                return c.emplace_equal(std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_equal(first, last);
             }
@@ -10,10 +10,10 @@
 
 namespace ZJ {
 
-    template <class Key, class HashFcn = hash<Key>, class KeyEquals = equal<Key>>
+    template <class Key, class HashFcn = hash<Key>, class KeyEquals = equal<Key>, class Alloc = allocator<Key>>
     class unordered_set {
         private : 
-            typedef hashtable<Key, Key, HashFcn, identity<Key>, KeyEquals> Container;
+            typedef hashtable<Key, Key, HashFcn, identity<Key>, KeyEquals, Alloc> Container;
             Container c;
         
         public : 
@@ -21,6 +21,7 @@ namespace ZJ {
             typedef typename Container::value_type  value_type;
             typedef typename Container::hasher      hasher;
             typedef typename Container::key_equal   key_equal;
+            typedef Alloc                           allocator_type;
 
             typedef typename Container::const_iterator  iterator; // read-only
             typedef typename Container::const_iterator  const_iterator;
@@ -39,8 +40,24 @@ namespace ZJ {
 
             unordered_set(size_type n, const hasher& hf, const key_equal& eql) : c(n, hf, eql) {}
 
+            unordered_set(size_type n, const hasher& hf, const key_equal& eql, const allocator_type& a) : c(n, hf, eql, a) {}
+
             unordered_set(const unordered_set& us) : c(us.c) {}
 
+            unordered_set(unordered_set&& us) : c(std::move(us.c)) {}
+
+            unordered_set& operator= (const unordered_set& us) {
+                c = us.c;
+                return *this;
+            }
+
+            unordered_set& operator= (unordered_set&& us) {
+                c = std::move(us.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
+
             hasher hash_function() const {return c.hash_function();}
 
             key_equal key_eq() const {return c.key_eq();}
@@ -64,6 +81,17 @@ namespace ZJ {
                 return pair<iterator, bool>(p.first, p.second);
             }
 
+            pair<iterator, bool> insert(value_type&& value) {
+                pair<typename Container::iterator, bool> p = c.insert_unique(std::move(value));
+                return pair<iterator, bool>(p.first, p.second);
+            }
+
+            template <typename... Args>
+            pair<iterator, bool> emplace(Args&&... args) {
+                pair<typename Container::iterator, bool> p = c.emplace_unique(std::forward<Args>(args)...);
+                return pair<iterator, bool>(p.first, p.second);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_unique(first, last);
             }
@@ -95,10 +123,10 @@ namespace ZJ {
             }
     };
 
-    template <class Key, class HashFcn = hash<Key>, class KeyEquals = equal<Key>>
+    template <class Key, class HashFcn = hash<Key>, class KeyEquals = equal<Key>, class Alloc = allocator<Key>>
     class unordered_multiset {
         private : 
-            typedef hashtable<Key, Key, HashFcn, identity<Key>, KeyEquals> Container;
+            typedef hashtable<Key, Key, HashFcn, identity<Key>, KeyEquals, Alloc> Container;
             Container c;
         
         public : 
@@ -106,6 +134,7 @@ namespace ZJ {
             typedef typename Container::value_type  value_type;
             typedef typename Container::hasher      hasher;
             typedef typename Container::key_equal   key_equal;
+            typedef Alloc                           allocator_type;
 
             typedef typename Container::const_iterator  iterator; // read-only
             typedef typename Container::const_iterator  const_iterator;
@@ -124,8 +153,24 @@ namespace ZJ {
 
             unordered_multiset(size_type n, const hasher& hf, const key_equal& eql) : c(n, hf, eql) {}
 
+            unordered_multiset(size_type n, const hasher& hf, const key_equal& eql, const allocator_type& a) : c(n, hf, eql, a) {}
+
             unordered_multiset(const unordered_multiset& us) : c(us.c) {}
 
+            unordered_multiset(unordered_multiset&& us) : c(std::move(us.c)) {}
+
+            unordered_multiset& operator= (const unordered_multiset& us) {
+                c = us.c;
+                return *this;
+            }
+
+            unordered_multiset& operator= (unordered_multiset&& us) {
+                c = std::move(us.c);
+                return *this;
+            }
+
+            allocator_type get_allocator() const {return c.get_allocator();}
+
             iterator begin() const {return c.begin();}
 
             const_iterator cbegin() const {return c.cbegin();}
@@ -144,6 +189,15 @@ namespace ZJ {
                 return c.insert_equal(value);
             }
 
+            iterator insert(value_type&& value) {
+                return c.insert_equal(std::move(value));
+            }
+
+            template <typename... Args>
+            iterator emplace(Args&&... args) {
+                return c.emplace_equal(std::forward<Args>(args)...);
+            }
+
             void insert(iterator first, iterator last) {
                 c.insert_equal(first, last);
             }
@@ -2,11 +2,32 @@
 #ifndef _ZJ_UTILS_
 #define _ZJ_UTILS_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include "ZJ_iterator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// constexpr where C++14 allows it (loops, assignments, several statements),
+// nothing before that
+#if __cplusplus >= 201402L
+#define ZJ_CONSTEXPR14 constexpr
+#else
+#define ZJ_CONSTEXPR14
+#endif
 
 namespace ZJ {
 
-    template <typename OutputIter, typename Value>
-    inline void ZJ_construct(OutputIter p, const Value& value);
+    template <typename OutputIter, typename... Args>
+    inline void ZJ_construct(OutputIter p, Args&&... args);
     template <typename OutputIter, typename Value>
     inline void ZJ_construct(OutputIter first, OutputIter last, const Value& value);
     template <typename OutputIter>
@@ -15,12 +36,24 @@ namespace ZJ {
     inline void ZJ_destroy(OutputIter first, OutputIter last);
     template <typename InputIter, typename OutputIter>
     inline OutputIter ZJ_uninitialized_copy(InputIter first, InputIter last, OutputIter dest);
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_uninitialized_move(InputIter first, InputIter last, OutputIter dest);
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_relocate(InputIter first, InputIter last, OutputIter dest);
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_relocate_backward(InputIter first, InputIter last, OutputIter dest_last);
     template <typename OutputIter, typename Value>
     inline void ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value);
     template <typename OutputIter, typename Value>
     inline OutputIter ZJ_uninitialized_fill_n(OutputIter dest, size_t n, const Value& value);
     template <typename InputIter, typename OutputIter>
     inline OutputIter ZJ_copy(InputIter first, InputIter last, OutputIter dest, bool copy2left = true);
+    template <typename OutputIter, typename Value>
+    inline void ZJ_fill(OutputIter first, OutputIter last, const Value& value);
+    template <typename InputIter, typename Func>
+    inline Func ZJ_for_each(InputIter first, InputIter last, Func f);
+    template <typename InputIter, typename Value>
+    inline Value ZJ_accumulate(InputIter first, InputIter last, Value init);
     template <typename T>
     inline void ZJ_swap(T& a, T& b);
     template<typename Iter>
@@ -33,58 +66,123 @@ namespace ZJ {
     struct TRUE_TAG {};
     struct FALSE_TAG {};
 
-    template <typename T>
-    class traits {
-        public : 
-            typedef FALSE_TAG IS_POD;
+    template <typename Tag1, typename Tag2>
+    struct tag_and {
+        typedef FALSE_TAG type;
     };
 
     template <>
-    class traits<int> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    struct tag_and<TRUE_TAG, TRUE_TAG> {
+        typedef TRUE_TAG type;
     };
 
-    template <>
-    class traits<float> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    template <bool B>
+    struct bool_tag {
+        typedef FALSE_TAG type;
     };
 
     template <>
-    class traits<double> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    struct bool_tag<true> {
+        typedef TRUE_TAG type;
     };
 
-    template <>
-    class traits<long> {
+    /**
+     * A T can be moved to another address by copying its bytes, and the old
+     * bytes are then dropped without running the destructor. Trivially
+     * copyable types are, and so is anything that only holds pointers or
+     * handles to memory outside itself (ZJ::vector, unique pointers, file
+     * handles). Types that point into themselves are not (std::string with
+     * its small buffer, list implementations with an embedded sentinel).
+     * Opt in with a specialization:
+     *      namespace ZJ { template <> struct is_trivially_relocatable<handle> : std::true_type {}; }
+    */
+    template <typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+    /**
+     * Built on the compiler's type traits, cv qualifiers are ignored.
+     * IS_TRIVIALLY_COPYABLE:    a copy is a memcpy (memmove / memset paths below)
+     * HAS_TRIVIAL_DESTRUCTOR:   destroying is a no-op
+     * IS_POD:                   both
+     * IS_TRIVIALLY_RELOCATABLE: move + destroy is a memcpy (ZJ_relocate)
+    */
+    template <typename T>
+    class traits {
+        private : 
+            typedef typename std::remove_cv<T>::type type;
+
         public : 
-            typedef TRUE_TAG IS_POD;
+            typedef typename bool_tag<std::is_trivially_copyable<type>::value>::type IS_TRIVIALLY_COPYABLE;
+            typedef typename bool_tag<std::is_trivially_destructible<type>::value>::type HAS_TRIVIAL_DESTRUCTOR;
+            typedef typename tag_and<IS_TRIVIALLY_COPYABLE, HAS_TRIVIAL_DESTRUCTOR>::type IS_POD;
+            typedef typename bool_tag<is_trivially_relocatable<type>::value>::type IS_TRIVIALLY_RELOCATABLE;
     };
 
-    template <>
-    class traits<short> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    /**
+     * Iterators into one array: [first, last) is the memory [address(first), address(last)).
+     * TRUE for raw pointers and vector_iterator (ZJ_vector.h).
+    */
+    template <typename Iter>
+    struct contiguous_iterator {
+        typedef FALSE_TAG type;
     };
 
-    template <>
-    class traits<bool> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    template <typename T>
+    struct contiguous_iterator<T*> {
+        typedef TRUE_TAG type;
+        static T* address(T* p) {return p;}
     };
 
-    template <>
-    class traits<char> {
-        public : 
-            typedef TRUE_TAG IS_POD;
+    /**
+     * Iterators over a sequence of arrays: [first, last) is walked one array
+     * at a time, and the algorithms below run their plain pointer loop on
+     * each run (which the compiler can unroll and vectorize, or which is a
+     * memmove) instead of checking for the end of a buffer on every ++.
+     * TRUE for deque_iterator (ZJ_deque.h); a specialization provides
+     *      pointer local(it)           it as a pointer into its array
+     *      pointer segment_end(it)     the end of that array
+     *      Iter next_segment(it)       the first element of the next array
+    */
+    template <typename Iter>
+    struct segmented_iterator {
+        typedef FALSE_TAG type;
     };
 
-    template <typename OutputIter, typename Value>
-    inline void ZJ_construct(OutputIter p, const Value& value) {
-        //new(const_cast<Value*>(&*p)) Value(value);
-        new(&*p) Value(value);
+    // f(b, e) on each contiguous run [b, e) of [first, last), in order
+    template <typename Iter, typename Func>
+    inline void ZJ_for_each_segment(Iter first, Iter last, Func f) {
+        typedef segmented_iterator<Iter> seg;
+        ptrdiff_t n = last - first;
+        while(n > 0) {
+            typename seg::pointer b = seg::local(first);
+            ptrdiff_t run = seg::segment_end(first) - b;
+            if(n <= run) {
+                f(b, b + n);
+                return ;
+            }
+            f(b, b + run);
+            n -= run;
+            first = seg::next_segment(first);
+        }
+    }
+
+    // TRUE_TAG when [first, last) -> dest may be a memmove
+    template <typename InputIter, typename OutputIter>
+    struct bulk_copy_tag {
+        typedef typename std::remove_cv<typename iterator_traits<InputIter>::value_type>::type in_type;
+        typedef typename std::remove_cv<typename iterator_traits<OutputIter>::value_type>::type out_type;
+        typedef typename tag_and<typename contiguous_iterator<InputIter>::type, 
+                                 typename contiguous_iterator<OutputIter>::type>::type contiguous;
+        typedef typename tag_and<typename bool_tag<std::is_same<in_type, out_type>::value>::type, 
+                                 typename traits<out_type>::IS_TRIVIALLY_COPYABLE>::type trivial;
+        typedef typename tag_and<contiguous, trivial>::type type;
+    };
+
+    // constructs the element p points to from args (copy, move or any constructor)
+    template <typename OutputIter, typename... Args>
+    inline void ZJ_construct(OutputIter p, Args&&... args) {
+        typedef typename std::remove_cv<typename iterator_traits<OutputIter>::value_type>::type value_type;
+        new((void*)&*p) value_type(std::forward<Args>(args)...);
     }
 
     template <typename OutputIter, typename Value>
@@ -97,10 +195,21 @@ namespace ZJ {
     inline void __ZJ_destroy(OutputIter first, OutputIter last, TRUE_TAG) {}
 
     template <typename OutputIter>
-    inline void __ZJ_destroy(OutputIter first, OutputIter last, FALSE_TAG) {
-        typedef typename OutputIter::value_type value_type;
+    inline void __ZJ_destroy_segments(OutputIter first, OutputIter last, TRUE_TAG) {
+        typedef typename segmented_iterator<OutputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [](pointer b, pointer e) {ZJ_destroy(b, e);});
+    }
+
+    template <typename OutputIter>
+    inline void __ZJ_destroy_segments(OutputIter first, OutputIter last, FALSE_TAG) {
+        typedef typename std::remove_cv<typename iterator_traits<OutputIter>::value_type>::type value_type;
         for(; first != last; ++first)
-            first->~value_type();
+            (&*first)->~value_type();
+    }
+
+    template <typename OutputIter>
+    inline void __ZJ_destroy(OutputIter first, OutputIter last, FALSE_TAG) {
+        __ZJ_destroy_segments(first, last, typename segmented_iterator<OutputIter>::type());
     }
 
     template <typename OutputIter>
@@ -108,26 +217,31 @@ namespace ZJ {
 
     template <typename OutputIter>
     inline void __ZJ_destroy(OutputIter p, FALSE_TAG) {
-        typedef typename OutputIter::value_type value_type;
-        p->~value_type();
+        typedef typename std::remove_cv<typename iterator_traits<OutputIter>::value_type>::type value_type;
+        (&*p)->~value_type();
     }
 
     template <typename OutputIter>
     inline void ZJ_destroy(OutputIter p) {
-        typedef typename traits<typename OutputIter::value_type>::IS_POD IS_POD;
-        //p->~value_type();
-        __ZJ_destroy(p, IS_POD());
+        typedef typename iterator_traits<OutputIter>::value_type value_type;
+        __ZJ_destroy(p, typename traits<value_type>::HAS_TRIVIAL_DESTRUCTOR());
     }
 
     template <typename OutputIter>
     inline void ZJ_destroy(OutputIter first, OutputIter last) {
-        typedef typename traits<typename OutputIter::value_type>::IS_POD IS_POD;
-        __ZJ_destroy(first, last, IS_POD());
+        typedef typename iterator_traits<OutputIter>::value_type value_type;
+        __ZJ_destroy(first, last, typename traits<value_type>::HAS_TRIVIAL_DESTRUCTOR());
     }
 
+    // contiguous and trivially copyable: one memmove, which also covers
+    // overlapping ranges (shifting elements inside a buffer)
     template <typename InputIter, typename OutputIter>
     inline OutputIter __ZJ_uninitialized_copy(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
-        return copy(first, last, dest);
+        typedef typename bulk_copy_tag<InputIter, OutputIter>::out_type value_type;
+        const value_type* src = contiguous_iterator<InputIter>::address(first);
+        size_t n = contiguous_iterator<InputIter>::address(last) - src;
+        if(n) memmove(contiguous_iterator<OutputIter>::address(dest), src, n * sizeof(value_type));
+        return dest + n;
     }
 
     template <typename InputIter, typename OutputIter>
@@ -137,32 +251,192 @@ namespace ZJ {
         return dest;
     }
 
+    // a segmented source is copied run by run, each run may be a memmove
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_uninitialized_copy_segments(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        typedef typename segmented_iterator<InputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [&dest](pointer b, pointer e) {dest = ZJ_uninitialized_copy(b, e, dest);});
+        return dest;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_uninitialized_copy_segments(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        return __ZJ_uninitialized_copy(first, last, dest, typename bulk_copy_tag<InputIter, OutputIter>::type());
+    }
+
     template <typename InputIter, typename OutputIter>
     inline OutputIter ZJ_uninitialized_copy(InputIter first, InputIter last, OutputIter dest) {
-        typedef typename traits<typename InputIter::value_type>::IS_POD IS_POD;
-        return __ZJ_uninitialized_copy(first, last, dest, IS_POD());
+        return __ZJ_uninitialized_copy_segments(first, last, dest, typename segmented_iterator<InputIter>::type());
     }
 
-    template <typename OutputIter, typename Value>
-    inline void __ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value, TRUE_TAG) {
-        fill(first, last, value);
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_uninitialized_move(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        return __ZJ_uninitialized_copy(first, last, dest, TRUE_TAG());
     }
 
-    template <typename OutputIter, typename Value>
-    inline void __ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value, FALSE_TAG) {
-        for(; first != last; ++first)
-            ZJ_construct(first, value);
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_uninitialized_move(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        for(; first != last; ++first, ++dest)
+            ZJ_construct(dest, std::move(*first));
+        return dest;
     }
 
-    template <typename OutputIter, typename Value>
-    inline void ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value) {
-        typedef typename traits<typename OutputIter::value_type>::IS_POD IS_POD;
-        __ZJ_uninitialized_fill(first, last, value, IS_POD());
+    // like ZJ_uninitialized_copy, but the source elements are moved from
+    // (they still have to be destroyed)
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_uninitialized_move(InputIter first, InputIter last, OutputIter dest) {
+        return __ZJ_uninitialized_move(first, last, dest, typename bulk_copy_tag<InputIter, OutputIter>::type());
+    }
+
+    /**
+     * Iterator categories, for ZJ's tags and the standard library's alike.
+     * is_forward_iterator:       TRUE_TAG when [first, last) can be walked twice,
+     *                            so its length can be taken before copying it
+     * is_random_access_iterator: TRUE_TAG when last - first works
+    */
+    template <typename Iter>
+    struct is_forward_iterator {
+        typedef typename iterator_traits<Iter>::iterator_category category;
+        typedef typename bool_tag<std::is_base_of<forward_iterator_tag, category>::value || 
+                                  std::is_base_of<std::forward_iterator_tag, category>::value>::type type;
+    };
+
+    template <typename Iter>
+    struct is_random_access_iterator {
+        typedef typename iterator_traits<Iter>::iterator_category category;
+        typedef typename bool_tag<std::is_base_of<random_access_iterator_tag, category>::value || 
+                                  std::is_base_of<std::random_access_iterator_tag, category>::value>::type type;
+    };
+
+    template <typename Iter>
+    inline size_t __ZJ_distance(Iter first, Iter last, TRUE_TAG) {
+        return last - first;
+    }
+
+    template <typename Iter>
+    inline size_t __ZJ_distance(Iter first, Iter last, FALSE_TAG) {
+        size_t n = 0;
+        for(; first != last; ++first) ++n;
+        return n;
     }
 
+    // number of elements in [first, last), last must be reachable from first
+    template <typename Iter>
+    inline size_t ZJ_distance(Iter first, Iter last) {
+        return __ZJ_distance(first, last, typename is_random_access_iterator<Iter>::type());
+    }
+
+    // TRUE_TAG when relocating [first, last) -> dest may copy bytes
+    template <typename InputIter, typename OutputIter>
+    struct relocate_tag {
+        typedef typename bulk_copy_tag<InputIter, OutputIter>::in_type in_type;
+        typedef typename bulk_copy_tag<InputIter, OutputIter>::out_type out_type;
+        typedef typename bulk_copy_tag<InputIter, OutputIter>::contiguous contiguous;
+        typedef typename tag_and<typename bool_tag<std::is_same<in_type, out_type>::value>::type, 
+                                 typename traits<out_type>::IS_TRIVIALLY_RELOCATABLE>::type type;
+    };
+
+    // contiguous: one memmove, in either direction
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_bytes(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        typedef typename relocate_tag<InputIter, OutputIter>::out_type value_type;
+        const value_type* src = contiguous_iterator<InputIter>::address(first);
+        size_t n = contiguous_iterator<InputIter>::address(last) - src;
+        if(n) memmove((void*)contiguous_iterator<OutputIter>::address(dest), (const void*)src, n * sizeof(value_type));
+        return dest + n;
+    }
+
+    // one memcpy per element (iterators that are not contiguous)
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_bytes(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        typedef typename relocate_tag<InputIter, OutputIter>::out_type value_type;
+        for(; first != last; ++first, ++dest)
+            memcpy((void*)&*dest, (const void*)&*first, sizeof(value_type));
+        return dest;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        return __ZJ_relocate_bytes(first, last, dest, typename relocate_tag<InputIter, OutputIter>::contiguous());
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        for(; first != last; ++first, ++dest) {
+            ZJ_construct(dest, std::move(*first));
+            ZJ_destroy(first);
+        }
+        return dest;
+    }
+
+    /**
+     * Moves [first, last) to the raw memory at dest and ends the lifetime of
+     * the source, which is raw memory afterwards: no destroy is needed, and
+     * none may be done. The ranges may overlap when dest is left of first
+     * (for ZJ_relocate_backward, when dest_last is right of last).
+     * Trivially relocatable types are copied as bytes, a single memmove for
+     * contiguous ranges; others are move constructed and destroyed one by one.
+    */
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_relocate(InputIter first, InputIter last, OutputIter dest) {
+        return __ZJ_relocate(first, last, dest, typename relocate_tag<InputIter, OutputIter>::type());
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_bytes_backward(InputIter first, InputIter last, OutputIter dest_last, TRUE_TAG) {
+        OutputIter dest_first = dest_last - (last - first);
+        __ZJ_relocate_bytes(first, last, dest_first, TRUE_TAG());
+        return dest_first;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_bytes_backward(InputIter first, InputIter last, OutputIter dest_last, FALSE_TAG) {
+        typedef typename relocate_tag<InputIter, OutputIter>::out_type value_type;
+        while(last != first) {
+            --last, --dest_last;
+            memcpy((void*)&*dest_last, (const void*)&*last, sizeof(value_type));
+        }
+        return dest_last;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_backward(InputIter first, InputIter last, OutputIter dest_last, TRUE_TAG) {
+        return __ZJ_relocate_bytes_backward(first, last, dest_last, typename relocate_tag<InputIter, OutputIter>::contiguous());
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_relocate_backward(InputIter first, InputIter last, OutputIter dest_last, FALSE_TAG) {
+        while(last != first) {
+            --last, --dest_last;
+            ZJ_construct(dest_last, std::move(*last));
+            ZJ_destroy(last);
+        }
+        return dest_last;
+    }
+
+    // returns the new first, dest_last - (last - first)
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter ZJ_relocate_backward(InputIter first, InputIter last, OutputIter dest_last) {
+        return __ZJ_relocate_backward(first, last, dest_last, typename relocate_tag<InputIter, OutputIter>::type());
+    }
+
+    // contiguous and trivially copyable: memset when every byte of the value is
+    // the same (zero, any char), a plain store loop otherwise
     template<typename OutputIter, typename Value>
     inline OutputIter __ZJ_uninitialized_fill_n(OutputIter dest, size_t n, const Value& value, TRUE_TAG) {
-        return fill_n(dest, n, value);
+        typedef typename std::remove_cv<typename iterator_traits<OutputIter>::value_type>::type value_type;
+        value_type* p = contiguous_iterator<OutputIter>::address(dest);
+        const value_type v = value;
+        const unsigned char* bytes = (const unsigned char*)&v;
+        size_t i = 1;
+        while(i < sizeof(value_type) && bytes[i] == bytes[0]) ++i;
+        if(i == sizeof(value_type)) {
+            if(n) memset(p, bytes[0], n * sizeof(value_type));
+        }
+        else {
+            for(i = 0; i < n; ++i) p[i] = v;
+        }
+        return dest + n;
     }
 
     template<typename OutputIter, typename Value>
@@ -172,18 +446,147 @@ namespace ZJ {
         return dest;
     }
 
+    template <typename OutputIter, typename Value>
+    inline OutputIter __ZJ_uninitialized_fill_n_segments(OutputIter dest, size_t n, const Value& value, TRUE_TAG) {
+        typedef typename segmented_iterator<OutputIter>::pointer pointer;
+        ZJ_for_each_segment(dest, dest + n, [&value](pointer b, pointer e) {ZJ_uninitialized_fill_n(b, e - b, value);});
+        return dest + n;
+    }
+
+    template <typename OutputIter, typename Value>
+    inline OutputIter __ZJ_uninitialized_fill_n_segments(OutputIter dest, size_t n, const Value& value, FALSE_TAG) {
+        typedef typename iterator_traits<OutputIter>::value_type value_type;
+        typedef typename tag_and<typename contiguous_iterator<OutputIter>::type, 
+                                 typename traits<value_type>::IS_TRIVIALLY_COPYABLE>::type tag;
+        return __ZJ_uninitialized_fill_n(dest, n, value, tag());
+    }
+
     template <typename OutputIter, typename Value>
     inline OutputIter ZJ_uninitialized_fill_n(OutputIter dest, size_t n, const Value& value) {
-        typedef typename traits<typename OutputIter::value_type>::IS_POD IS_POD;
-        return __ZJ_uninitialized_fill_n(dest, n, value, IS_POD());
+        return __ZJ_uninitialized_fill_n_segments(dest, n, value, typename segmented_iterator<OutputIter>::type());
+    }
+
+    template <typename OutputIter, typename Value>
+    inline void __ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value, TRUE_TAG) {
+        size_t n = contiguous_iterator<OutputIter>::address(last) - contiguous_iterator<OutputIter>::address(first);
+        __ZJ_uninitialized_fill_n(first, n, value, TRUE_TAG());
+    }
+
+    template <typename OutputIter, typename Value>
+    inline void __ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value, FALSE_TAG) {
+        for(; first != last; ++first)
+            ZJ_construct(first, value);
+    }
+
+    template <typename OutputIter, typename Value>
+    inline void ZJ_uninitialized_fill(OutputIter first, OutputIter last, const Value& value) {
+        typedef typename iterator_traits<OutputIter>::value_type value_type;
+        typedef typename tag_and<typename contiguous_iterator<OutputIter>::type, 
+                                 typename traits<value_type>::IS_TRIVIALLY_COPYABLE>::type tag;
+        __ZJ_uninitialized_fill(first, last, value, tag());
+    }
+
+    // popcnt / tzcnt when the target has them (-mpopcnt -mbmi, -march=native),
+    // the compiler's best bit trick otherwise
+    inline size_t __ZJ_popcount64(uint64_t x) {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (size_t)__builtin_popcountll(x);
+    #elif defined(_MSC_VER) && defined(_M_X64)
+        return (size_t)__popcnt64(x);
+    #else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (size_t)((x * 0x0101010101010101ULL) >> 56);
+    #endif
+    }
+
+    // index of the lowest set bit, x != 0
+    inline size_t __ZJ_ctz64(uint64_t x) {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (size_t)__builtin_ctzll(x);
+    #elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanForward64(&i, x);
+        return (size_t)i;
+    #else
+        size_t i = 0;
+        while(!(x & 1)) x >>= 1, ++i;
+        return i;
+    #endif
+    }
+
+    // index of the highest set bit, x != 0
+    inline size_t __ZJ_msb64(uint64_t x) {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (size_t)(63 - __builtin_clzll(x));
+    #elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanReverse64(&i, x);
+        return (size_t)i;
+    #else
+        size_t i = 0;
+        while(x >>= 1) ++i;
+        return i;
+    #endif
+    }
+
+    // contiguous and trivially copyable: one memmove
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        typedef typename bulk_copy_tag<InputIter, OutputIter>::out_type value_type;
+        const value_type* src = contiguous_iterator<InputIter>::address(first);
+        size_t n = contiguous_iterator<InputIter>::address(last) - src;
+        memmove((void*)contiguous_iterator<OutputIter>::address(dest), (const void*)src, n * sizeof(value_type));
+        return dest + n;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        for(; first != last; ++first, ++dest)
+            *dest = *first;
+        return dest;
+    }
+
+    // a segmented dest (and a random access source) is filled run by run
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy_to_segments(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        typedef typename segmented_iterator<OutputIter>::pointer pointer;
+        ptrdiff_t n = last - first;
+        ZJ_for_each_segment(dest, dest + n, [&first](pointer b, pointer e) {
+            ZJ_copy(first, first + (e - b), b);
+            first += e - b;
+        });
+        return dest + n;
     }
 
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy_to_segments(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        return __ZJ_copy(first, last, dest, typename bulk_copy_tag<InputIter, OutputIter>::type());
+    }
+
+    // a segmented source is copied run by run, each run to dest as above
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy_segments(InputIter first, InputIter last, OutputIter dest, TRUE_TAG) {
+        typedef typename segmented_iterator<InputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [&dest](pointer b, pointer e) {dest = ZJ_copy(b, e, dest);});
+        return dest;
+    }
+
+    template <typename InputIter, typename OutputIter>
+    inline OutputIter __ZJ_copy_segments(InputIter first, InputIter last, OutputIter dest, FALSE_TAG) {
+        typedef typename tag_and<typename segmented_iterator<OutputIter>::type,
+                                 typename is_random_access_iterator<InputIter>::type>::type tag;
+        return __ZJ_copy_to_segments(first, last, dest, tag());
+    }
+
+    // copy2left: front to back, dest may overlap the right part of [first, last)
+    // (segmented iterators are walked run by run); otherwise back to front
     template <typename InputIter, typename OutputIter>
     inline OutputIter ZJ_copy(InputIter first, InputIter last, OutputIter dest, bool copy2left) {
         if(first == last) return dest;
         if (copy2left) { 
-            for(; first != last; ++first, ++dest)
-                *dest = *first;
+            return __ZJ_copy_segments(first, last, dest, typename segmented_iterator<InputIter>::type());
         }
         else {
             dest += (last - first);
@@ -195,11 +598,70 @@ namespace ZJ {
         return dest;
     }
 
+    template <typename OutputIter, typename Value>
+    inline void __ZJ_fill(OutputIter first, OutputIter last, const Value& value, TRUE_TAG) {
+        typedef typename segmented_iterator<OutputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [&value](pointer b, pointer e) {ZJ_fill(b, e, value);});
+    }
+
+    template <typename OutputIter, typename Value>
+    inline void __ZJ_fill(OutputIter first, OutputIter last, const Value& value, FALSE_TAG) {
+        for(; first != last; ++first)
+            *first = value;
+    }
+
+    // assigns value to every element of [first, last)
+    template <typename OutputIter, typename Value>
+    inline void ZJ_fill(OutputIter first, OutputIter last, const Value& value) {
+        __ZJ_fill(first, last, value, typename segmented_iterator<OutputIter>::type());
+    }
+
+    template <typename InputIter, typename Func>
+    inline void __ZJ_for_each(InputIter first, InputIter last, Func& f, TRUE_TAG) {
+        typedef typename segmented_iterator<InputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [&f](pointer b, pointer e) {
+            for(; b != e; ++b) f(*b);
+        });
+    }
+
+    template <typename InputIter, typename Func>
+    inline void __ZJ_for_each(InputIter first, InputIter last, Func& f, FALSE_TAG) {
+        for(; first != last; ++first)
+            f(*first);
+    }
+
+    // f(*it) for every element in order, returns f
+    template <typename InputIter, typename Func>
+    inline Func ZJ_for_each(InputIter first, InputIter last, Func f) {
+        __ZJ_for_each(first, last, f, typename segmented_iterator<InputIter>::type());
+        return f;
+    }
+
+    template <typename InputIter, typename Value>
+    inline Value __ZJ_accumulate(InputIter first, InputIter last, Value init, TRUE_TAG) {
+        typedef typename segmented_iterator<InputIter>::pointer pointer;
+        ZJ_for_each_segment(first, last, [&init](pointer b, pointer e) {init = ZJ_accumulate(b, e, init);});
+        return init;
+    }
+
+    template <typename InputIter, typename Value>
+    inline Value __ZJ_accumulate(InputIter first, InputIter last, Value init, FALSE_TAG) {
+        for(; first != last; ++first)
+            init = init + *first;
+        return init;
+    }
+
+    // init + *first + ... in order
+    template <typename InputIter, typename Value>
+    inline Value ZJ_accumulate(InputIter first, InputIter last, Value init) {
+        return __ZJ_accumulate(first, last, init, typename segmented_iterator<InputIter>::type());
+    }
+
     template <typename T>
     inline void ZJ_swap(T& a, T& b) {
-        T tmp = a;
-        a = b;
-        b = tmp;
+        T tmp(std::move(a));
+        a = std::move(b);
+        b = std::move(tmp);
     }
 
     template<typename Iter>
@@ -96,10 +96,25 @@ namespace ZJ {
             }
     };
 
-    template <typename T, typename Alloc = ZJ::allocator<T>>
-    class vector {
+    template <typename T>
+    struct contiguous_iterator<vector_iterator<T>> {
+        typedef TRUE_TAG type;
+        static T* address(const vector_iterator<T>& it) {return it.operator->();}
+    };
+
+    /**
+     * Buffer [start, storage_end) with the elements in [start, finish), and
+     * everything vector and small_vector (ZJ_small_vector.h) do the same way
+     * on it. Derived decides where the buffer comes from:
+     *      reallocate_storage(new_cap, realloc_tag)    moves the elements to a buffer of new_cap >= size()
+     *      release_storage()                           gives the buffer back
+     * the versions here are for a heap buffer from Alloc.
+    */
+    template <typename T, typename Alloc, typename Derived>
+    class __vector_base : protected Alloc {
         public : 
             typedef T                           value_type;
+            typedef Alloc                       allocator_type;
             typedef T*                          pointer;
             typedef const T*                    const_pointer;
             typedef vector_iterator<T>          iterator;
@@ -111,36 +126,20 @@ namespace ZJ {
         
         protected : 
             typedef Alloc vector_allocator;
+            // grow / shrink the buffer in place with reallocate (realloc, mremap)
+            // instead of allocate + relocate
+            typedef typename tag_and<typename alloc_traits<Alloc>::HAS_REALLOCATE, 
+                                     typename traits<T>::IS_TRIVIALLY_RELOCATABLE>::type realloc_tag;
             iterator start;
             iterator finish;
             iterator storage_end;
-        
-        public : 
-            vector() : start(), finish(), storage_end() {}
 
-            vector(size_type n) {alloc_construct((size_type)n, T()); }
- 
-            vector(size_type n, const T& value) {alloc_construct((size_type)n, value); }
+            __vector_base() : start(), finish(), storage_end() {}
 
-            vector(const_iterator first, const_iterator last) {
-                size_type n = last - first;
-                start = vector_allocator::allocate(n);
-                ZJ_uninitialized_copy(first, last, begin());
-                finish = start + n;
-                storage_end = start + n;
-            }
-            
-            vector(const vector<T>& v) {
-                start = vector_allocator::allocate(v.capacity());
-                ZJ_uninitialized_copy(v.begin(), v.end(), begin());
-                finish = start + v.size();
-                storage_end = start + v.capacity();
-            }
+            explicit __vector_base(const Alloc& a) : Alloc(a), start(), finish(), storage_end() {}
 
-            ~vector() {
-                ZJ_destroy(start, finish);
-                vector_allocator::deallocate(&*start, size());
-            }
+        public : 
+            allocator_type get_allocator() const {return *static_cast<const Alloc*>(this);}
 
             iterator begin() {
                 return start;
@@ -190,26 +189,51 @@ namespace ZJ {
                 return *(start + idx);
             }
 
-            void reserve(size_type new_size) {
-                if(new_size < size()) {  // shrinking
-                    ZJ_destroy(start + new_size, finish);
-                    finish = start + new_size;
-                }
-                else { // extending
-                    iterator new_start = allocator<value_type>::allocate(new_size);
-                    size_type n = size();
-                    ZJ_uninitialized_copy(start, finish, new_start);
-                    ZJ_destroy(start, start + n);
-                    start = new_start;
-                    finish = start + n;
-                    storage_end = start + new_size;
-                }
+            const_reference operator[] (size_type idx) const {
+                return *(start + idx);
+            }
+
+            pointer data() {return start.operator->();}
+
+            const_pointer data() const {return start.operator->();}
+
+            // never shrinks, see shrink_to_fit
+            void reserve(size_type new_cap) {
+                if(new_cap <= capacity()) return ;
+                derived().reallocate_storage(new_cap, realloc_tag());
             }
 
             void push_back(const value_type& value) {
-                if(finish == storage_end) reserve(2 * capacity() + 1);
-                ZJ_construct(finish, value);
+                emplace_back(value);
+            }
+
+            void push_back(value_type&& value) {
+                emplace_back(std::move(value));
+            }
+
+            template <typename... Args>
+            void emplace_back(Args&&... args) {
+                if(finish != storage_end) {
+                    ZJ_construct(finish, std::forward<Args>(args)...);
+                    ++finish;
+                }
+                else emplace(end(), std::forward<Args>(args)...);
+            }
+
+            template <typename... Args>
+            iterator emplace(iterator pos, Args&&... args) {
+                size_type index = pos - start;
+                if(finish == storage_end || pos != finish) {
+                    // args may refer to an element that is about to be moved
+                    T tmp(std::forward<Args>(args)...);
+                    if(finish == storage_end) reserve(2 * capacity() + 1);
+                    pos = start + index;
+                    ZJ_relocate_backward(pos, finish, finish + 1);
+                    ZJ_construct(pos, std::move(tmp));
+                }
+                else ZJ_construct(finish, std::forward<Args>(args)...);
                 ++finish;
+                return start + index;
             }
 
             void pop_back() {
@@ -217,78 +241,253 @@ namespace ZJ {
                 ZJ_destroy(finish);
             }
 
-            void insert(iterator pos, const T& value) {
-                insert(pos, 1, value);
+            iterator insert(iterator pos, const T& value) {
+                return emplace(pos, value);
+            }
+
+            iterator insert(iterator pos, T&& value) {
+                return emplace(pos, std::move(value));
             }
             
             void insert(iterator pos, size_type n, const T& value) { 
-                if (n + size() > capacity()) {
-                    iterator new_start = vector_allocator::allocate(2 * (n + size()));
-                    iterator it = ZJ_uninitialized_copy(start, pos, new_start);
-                    finish = ZJ_uninitialized_copy(pos, finish, it + n);
-                    ZJ_uninitialized_fill_n(it, n, value);
-                    start = new_start;
-                    storage_end = start + 2 * (finish - start);
-                }
-                else {
-                    finish = ZJ_uninitialized_copy(pos, finish, pos + n);
-                    ZJ_uninitialized_fill_n(pos, n, value);
-                }
+                if(n == 0) return ;
+                T tmp(value); // value may be an element of this vector
+                size_type index = pos - start;
+                if(n + size() > capacity()) reserve(n > size() ? n + size() : 2 * size());
+                pos = start + index;
+                ZJ_relocate_backward(pos, finish, finish + n);
+                ZJ_uninitialized_fill_n(pos, n, tmp);
+                finish += n;
             }
             
-            // TO BE FIXED: cannot handle iterator of different type
-            // cannot handle iterator from current vector - iterator invalidation
-            // use a template 
-            // tempalte <typename InputIter, typename OutputIter>
-            // void insert(OutputIter pos, InputIter first, InputIter last)
-            void insert(iterator pos, iterator first, iterator last) { 
-                size_type n = last - first;
-                if (n + size() > capacity()) {
-                    iterator new_start = vector_allocator::allocate(2 * (n + size()));
-                    iterator it = ZJ_uninitialized_copy(start, pos, new_start);
-                    finish = ZJ_uninitialized_copy(pos, finish, it + n);
-                    ZJ_uninitialized_copy(first, last, it);
-                    start = new_start;
-                    storage_end = start + 2 * (finish - start);
-                } 
-                else {
-                    finish = ZJ_uninitialized_copy(pos, finish, pos + n);
-                    ZJ_uninitialized_copy(first, last, pos);
-                }
+            template <typename InputIterator>
+            void insert(iterator pos, InputIterator first, InputIterator last) {
+                insert_dispatch(pos, first, last, typename bool_tag<std::is_integral<InputIterator>::value>::type());
+            }
+
+            // insert(end(), first, last)
+            template <typename InputIterator>
+            void append(InputIterator first, InputIterator last) {
+                insert(end(), first, last);
             }
 
             iterator erase(iterator pos) {
-                if(pos + 1 != end())
-                    copy(pos + 1, finish, pos);
+                ZJ_destroy(pos);
+                ZJ_relocate(pos + 1, finish, pos);
                 --finish;
-                destroy(finish);
                 return pos;
             }
 
             iterator erase(iterator first, iterator last) {
-                iterator new_finish = ZJ_uninitialized_copy(last, finish, first);
-                ZJ_destroy(new_finish, finish);
-                finish -= (last - first);
+                if(first == last) return first;
+                ZJ_destroy(first, last);
+                finish = ZJ_relocate(last, finish, first);
                 return first;
             }
 
+            // keeps the buffer
             void clear() {erase(start, finish); }
+        
+        protected : 
+            Derived& derived() {return *static_cast<Derived*>(this);}
+
+            // insert(pos, 3, 5) with ints lands in the template, it means 3 copies of 5
+            template <typename Integer>
+            void insert_dispatch(iterator pos, Integer n, Integer value, TRUE_TAG) {
+                insert(pos, (size_type)n, (value_type)value);
+            }
+
+            template <typename InputIterator>
+            void insert_dispatch(iterator pos, InputIterator first, InputIterator last, FALSE_TAG) {
+                range_insert(pos, first, last, typename is_forward_iterator<InputIterator>::type());
+            }
+
+            // forward iterators: the length is known up front, so at most one new buffer,
+            // and the source is copied straight into the gap (one memmove when it can)
+            template <typename ForwardIterator>
+            void range_insert(iterator pos, ForwardIterator first, ForwardIterator last, TRUE_TAG) {
+                size_type n = ZJ_distance(first, last);
+                if(n == 0) return ;
+                if(in_storage(first, typename contiguous_iterator<ForwardIterator>::type())) {
+                    // [first, last) is part of this vector and would move under the copy
+                    Derived tmp(get_allocator());
+                    tmp.reserve(n);
+                    __vector_base& t = tmp;
+                    t.finish = ZJ_uninitialized_copy(first, last, t.start);
+                    relocate_insert(pos, t);
+                    return ;
+                }
+                size_type index = pos - start;
+                if(n + size() > capacity()) {
+                    size_type new_cap = n > size() ? n + size() : 2 * size();
+                    iterator new_start = vector_allocator::allocate(new_cap);
+                    ZJ_uninitialized_copy(first, last, new_start + index);
+                    ZJ_relocate(start, pos, new_start);
+                    iterator new_finish = ZJ_relocate(pos, finish, new_start + index + n);
+                    derived().release_storage();
+                    start = new_start;
+                    finish = new_finish;
+                    storage_end = start + new_cap;
+                }
+                else {
+                    ZJ_relocate_backward(pos, finish, finish + n);
+                    ZJ_uninitialized_copy(first, last, pos);
+                    finish += n;
+                }
+            }
 
-            void swap(vector<T>& rhs) {
-                ZJ_swap(start, rhs.start);
-                ZJ_swap(finish, rhs.finish);
-                ZJ_swap(storage_end, rhs.storage_end);
+            // input iterators can only be read once: collected first, then relocated in
+            template <typename InputIterator>
+            void range_insert(iterator pos, InputIterator first, InputIterator last, FALSE_TAG) {
+                if(pos == finish) {
+                    for(; first != last; ++first) emplace_back(*first);
+                    return ;
+                }
+                Derived tmp(get_allocator());
+                for(; first != last; ++first) tmp.emplace_back(*first);
+                relocate_insert(pos, tmp);
+            }
+
+            // moves all of v's elements in front of pos, v is left empty
+            void relocate_insert(iterator pos, __vector_base& v) {
+                size_type n = v.size();
+                if(n == 0) return ;
+                size_type index = pos - start;
+                if(n + size() > capacity()) reserve(n > size() ? n + size() : 2 * size());
+                pos = start + index;
+                ZJ_relocate_backward(pos, finish, finish + n);
+                ZJ_relocate(v.start, v.finish, pos);
+                v.finish = v.start;
+                finish += n;
+            }
+
+            template <typename Iter>
+            bool in_storage(Iter it, TRUE_TAG) const {
+                const void* p = contiguous_iterator<Iter>::address(it);
+                return p >= (const void*)start.operator->() && p < (const void*)finish.operator->();
+            }
+
+            template <typename Iter>
+            bool in_storage(Iter, FALSE_TAG) const {return false;}
+
+            // moves the elements into a heap buffer of new_cap >= size() elements
+            void reallocate_storage(size_type new_cap, TRUE_TAG) {
+                size_type n = size();
+                start = vector_allocator::reallocate(data(), capacity(), new_cap);
+                finish = start + n;
+                storage_end = start + new_cap;
+            }
+
+            void reallocate_storage(size_type new_cap, FALSE_TAG) {
+                size_type n = size();
+                iterator new_start = vector_allocator::allocate(new_cap);
+                ZJ_relocate(start, finish, new_start);
+                derived().release_storage();
+                start = new_start;
+                finish = start + n;
+                storage_end = start + new_cap;
+            }
+
+            void release_storage() {
+                vector_allocator::deallocate(data(), capacity());
+            }
+    };
+
+    template <typename T, typename Alloc = ZJ::allocator<T>>
+    class vector : public __vector_base<T, Alloc, vector<T, Alloc>> {
+        friend class __vector_base<T, Alloc, vector<T, Alloc>>;
+
+        protected : 
+            typedef __vector_base<T, Alloc, vector<T, Alloc>> base;
+            typedef Alloc vector_allocator;
+
+        public : 
+            typedef typename base::iterator         iterator;
+            typedef typename base::const_iterator   const_iterator;
+            typedef typename base::size_type        size_type;
+
+            vector() {}
+
+            explicit vector(const Alloc& a) : base(a) {}
+
+            vector(size_type n) {alloc_construct((size_type)n, T()); }
+ 
+            vector(size_type n, const T& value, const Alloc& a = Alloc()) : base(a) {alloc_construct((size_type)n, value); }
+
+            vector(const_iterator first, const_iterator last, const Alloc& a = Alloc()) : base(a) {
+                size_type n = last - first;
+                this->start = vector_allocator::allocate(n);
+                ZJ_uninitialized_copy(first, last, this->begin());
+                this->finish = this->start + n;
+                this->storage_end = this->start + n;
+            }
+            
+            vector(const vector& v) : base(v.get_allocator()) {
+                this->start = vector_allocator::allocate(v.capacity());
+                ZJ_uninitialized_copy(v.begin(), v.end(), this->begin());
+                this->finish = this->start + v.size();
+                this->storage_end = this->start + v.capacity();
+            }
+
+            vector(vector&& v) : base(v.get_allocator()) {
+                this->start = v.start;
+                this->finish = v.finish;
+                this->storage_end = v.storage_end;
+                v.start = v.finish = v.storage_end = iterator();
+            }
+
+            ~vector() {
+                ZJ_destroy(this->start, this->finish);
+                this->release_storage();
+            }
+
+            vector& operator= (const vector& rhs) {
+                if(this != &rhs) {
+                    vector tmp(rhs);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            vector& operator= (vector&& rhs) {
+                if(this != &rhs) {
+                    vector tmp(std::move(rhs));
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            // capacity becomes size, an empty vector gives its buffer back
+            void shrink_to_fit() {
+                if(this->finish == this->storage_end) return ;
+                if(this->empty()) {
+                    this->release_storage();
+                    this->start = this->finish = this->storage_end = iterator();
+                    return ;
+                }
+                this->reallocate_storage(this->size(), typename base::realloc_tag());
+            }
+
+            void swap(vector& rhs) {
+                ZJ_swap(static_cast<Alloc&>(*this), static_cast<Alloc&>(rhs));
+                ZJ_swap(this->start, rhs.start);
+                ZJ_swap(this->finish, rhs.finish);
+                ZJ_swap(this->storage_end, rhs.storage_end);
             }
         
         protected : 
             void alloc_construct(size_type n, const T& value) {
-                start = vector_allocator::allocate(n);
-                finish = start + n;
-                storage_end = finish;
-                ZJ_construct(start, finish, value);
+                this->start = vector_allocator::allocate(n);
+                this->finish = this->start + n;
+                this->storage_end = this->finish;
+                ZJ_construct(this->start, this->finish, value);
             }
     };
 
+    // three pointers into the heap, moving them moves the vector
+    template <typename T, typename Alloc>
+    struct is_trivially_relocatable<vector<T, Alloc>> : is_trivially_relocatable<Alloc> {};
+
 }
 
 #endif
@@ -0,0 +1,109 @@
+/**
+ * deque<T> with buffers of 512 B to 64 KB: push_back, pop_front, a queue
+ * of steady length, random operator[], iteration with ++ and with
+ * ZJ_accumulate (one loop per buffer). ZJ_DEQUE_BUFFER_BYTES, the default
+ * buffer size, was picked from this table.
+ * Reports ns per element (per operation for the queue and random reads).
+ *
+ * build: g++ -O2 -std=c++11 -I.. deque_buffer_sweep.cpp -o deque_buffer_sweep
+ * run:   ./deque_buffer_sweep [num_elements]
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include "../ZJ_deque.h"
+
+struct record {
+    long long key;
+    long long payload[7];   // 64 bytes
+};
+
+static long long value_of(long long x) {return x;}
+
+static long long value_of(const record& r) {return r.key;}
+
+static record make(long long x, record*) {
+    record r;
+    r.key = x;
+    for(int i = 0; i < 7; ++i) r.payload[i] = x;
+    return r;
+}
+
+static int make(long long x, int*) {return (int)x;}
+
+record operator+ (const record& a, const record& b) {return make(a.key + b.key, (record*)0);}
+
+static unsigned int next_rand(unsigned int& s) {
+    s = s * 1103515245u + 12345u;
+    return s >> 1;
+}
+
+static double ns_since(std::chrono::steady_clock::time_point t0, size_t ops) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ops;
+}
+
+// volatile sink so the loops are not optimized out
+static volatile long long sink;
+
+template <typename T, size_t BYTES>
+void run(size_t n) {
+    typedef ZJ::deque<T, ZJ::deque_buffer_bytes<T, BYTES>::value> deque;
+    deque d;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < n; ++i) d.push_back(make((long long)i, (T*)0));
+    double push = ns_since(t0, n);
+
+    t0 = std::chrono::steady_clock::now();
+    long long s = 0;
+    for(typename deque::iterator it = d.begin(); it != d.end(); ++it) s += value_of(*it);
+    double iterate = ns_since(t0, n);
+    sink = s;
+
+    t0 = std::chrono::steady_clock::now();
+    sink = value_of(ZJ::ZJ_accumulate(d.begin(), d.end(), T()));
+    double accumulate = ns_since(t0, n);
+
+    unsigned int seed = 1;
+    size_t reads = n / 4;
+    t0 = std::chrono::steady_clock::now();
+    s = 0;
+    for(size_t i = 0; i < reads; ++i) s += value_of(d[next_rand(seed) % n]);
+    double random = ns_since(t0, reads);
+    sink = s;
+
+    t0 = std::chrono::steady_clock::now();
+    while(!d.empty()) d.pop_front();
+    double pop = ns_since(t0, n);
+
+    // a queue of 1000 elements sliding through the map
+    for(size_t i = 0; i < 1000; ++i) d.push_back(make((long long)i, (T*)0));
+    t0 = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        d.push_back(make((long long)i, (T*)0));
+        d.pop_front();
+    }
+    double queue = ns_since(t0, n);
+
+    printf("%6zu B %7zu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", BYTES, (size_t)deque::iterator::buffer_size(),
+           push, pop, queue, random, iterate, accumulate);
+}
+
+template <typename T>
+void sweep(const char* name, size_t n) {
+    printf("\n%s, %zu elements, ns per element\n", name, n);
+    printf("  buffer   elems push_back pop_front     queue    random  iterate++ accumulate\n");
+    run<T, 512>(n);
+    run<T, 1024>(n);
+    run<T, 4096>(n);
+    run<T, 16384>(n);
+    run<T, 65536>(n);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], 0, 10) : (size_t)1 << 24;
+    sweep<int>("deque<int>", n);
+    sweep<record>("deque<record> (64 bytes)", n / 4);
+    return 0;
+}
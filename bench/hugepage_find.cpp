@@ -0,0 +1,111 @@
+/**
+ * Random find() into a large unordered_set<int>, bucket array on normal pages
+ * vs. huge pages (__allocator_hugepage).
+ * Reports time per lookup and, where perf events are available (Linux,
+ * perf_event_paranoid <= 2), dTLB load misses per lookup.
+ *
+ * build: g++ -O2 -std=c++11 -I.. hugepage_find.cpp -o hugepage_find
+ * run:   ./hugepage_find [num_elements] [num_lookups]
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include "../ZJ_unordered_set.h"
+#include "../ZJ_hugepage.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// dTLB read misses of this thread, user space only; -1 if not available
+class tlb_counter {
+    private :
+        int fd;
+
+    public :
+        tlb_counter() : fd(-1) {
+        #if defined(__linux__)
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        #endif
+        }
+
+        ~tlb_counter() {
+        #if defined(__linux__)
+            if(fd >= 0) close(fd);
+        #endif
+        }
+
+        void start() {
+        #if defined(__linux__)
+            if(fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        #endif
+        }
+
+        long long stop() {
+            long long res = -1;
+        #if defined(__linux__)
+            if(fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if(read(fd, &res, sizeof(res)) != sizeof(res)) res = -1;
+            }
+        #endif
+            return res;
+        }
+};
+
+static unsigned int next_rand(unsigned int& s) {
+    s = s * 1103515245u + 12345u;
+    return s >> 1;
+}
+
+template <typename Set>
+void run(const char* name, size_t n, size_t lookups) {
+    Set s(n, ZJ::hash<int>(), ZJ::equal<int>(), typename Set::allocator_type());
+    unsigned int seed = 1;
+    for(size_t i = 0; i < n; ++i) s.insert((int)next_rand(seed));
+
+    tlb_counter tlb;
+    size_t found = 0;
+    seed = 1;
+    tlb.start();
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    for(size_t i = 0; i < lookups; ++i) {
+        // half hits (replaying the insert sequence), half misses
+        if(i % n == 0) seed = 1;
+        int key = (i & 1) ? (int)next_rand(seed) : (int)(next_rand(seed) ^ 0x5bd1e995);
+        if(s.find(key) != s.end()) ++found;
+    }
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    long long misses = tlb.stop();
+
+    double ns = chrono::duration<double, nano>(t1 - t0).count() / lookups;
+    printf("%-10s %7.1f ns/find", name, ns);
+    if(misses >= 0) printf("  %6.3f dTLB misses/find", (double)misses / lookups);
+    else printf("  (dTLB counter unavailable)");
+    printf("  [found %zu]\n", found);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], 0, 10) : (size_t)1 << 23;
+    size_t lookups = argc > 2 ? strtoul(argv[2], 0, 10) : (size_t)1 << 24;
+    printf("unordered_set<int>, %zu elements, %zu random finds\n", n, lookups);
+    run<ZJ::unordered_set<int>>("malloc", n, lookups);
+    run<ZJ::unordered_set<int, ZJ::hash<int>, ZJ::equal<int>, ZJ::hugepage_allocator<int>>>("hugepage", n, lookups);
+    return 0;
+}